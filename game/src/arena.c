@@ -0,0 +1,223 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+
+#include "arena.h"
+
+// Items and the slab header are padded to this so that any type can live in
+// a pool
+#define POOL_ALIGN 16
+#define POOL_ROUND(size) (((size) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+
+// Every live pool, for reporting
+static Pool* pools = NULL;
+
+// Running totals across every pool, including destroyed ones
+static PoolStats totals;
+
+static void linkMethods(Pool*);
+
+static void* alloc(Pool*);
+static void release(Pool*, void*);
+static void destroy(Pool*);
+
+static bool addSlab(Pool*);
+
+
+Pool* newPool(const char* name, size_t itemSize, int slabItems)
+{
+    Pool* pool;
+
+    if (! (pool = (Pool*)malloc(sizeof(Pool))))
+    {
+        fprintf(stderr, ERR_POOL_MALLOC);
+        return NULL;
+    }
+
+    memset(pool, 0, sizeof(Pool));
+    linkMethods(pool);
+
+    strncpy(pool->name, name, POOL_NAME_SIZE - 1);
+    pool->itemSize = POOL_ROUND(MAX(itemSize, sizeof(void*)));
+    pool->slabItems = MAX(slabItems, 1);
+
+    pool->next = pools;
+    pools = pool;
+
+    return pool;
+}
+
+
+void* poolAlloc(Pool** pool, const char* name, size_t itemSize)
+{
+    // Pools are created on first use
+    if (! *pool)
+    {
+        if (! (*pool = newPool(name, itemSize, POOL_SLAB_ITEMS)))
+            return NULL;
+
+        (*pool)->owner = pool;
+    }
+
+    return (*pool)->alloc(*pool);
+}
+
+
+void poolRelease(Pool** pool, void* item)
+{
+    if (! *pool || ! item)
+        return;
+
+    (*pool)->release(*pool, item);
+
+    // Last item gone, hand every slab back at once
+    if (! (*pool)->stats.live)
+    {
+        (*pool)->destroy(*pool);
+        SAFE_FREE(*pool);
+    }
+}
+
+
+// Every slab of every pool is freed whole, along with whatever is still live
+// in it, rather than one item at a time
+void freePools()
+{
+    Pool* pool;
+
+    while ((pool = pools))
+    {
+        if (pool->owner)
+            *(pool->owner) = NULL;
+
+        // Unlinks the pool from pools
+        pool->destroy(pool);
+        SAFE_FREE(pool);
+    }
+}
+
+
+void getPoolTotals(PoolStats* stats)
+{
+    memcpy(stats, &totals, sizeof(PoolStats));
+}
+
+
+void logPools(FILE* f)
+{
+    for (Pool* pool = pools; pool; pool = pool->next)
+        fprintf(f, "%-16s: %d live (peak %d), %lu allocations, "
+                   "%lu slabs, %zu bytes (peak %zu)\n",
+                pool->name, pool->stats.live, pool->stats.peakLive,
+                pool->stats.allocations, pool->stats.systemAllocations,
+                pool->stats.bytes, pool->stats.peakBytes);
+}
+
+
+static void linkMethods(Pool* this)
+{
+    this->alloc = alloc;
+    this->release = release;
+    this->destroy = destroy;
+}
+
+
+static void* alloc(Pool* this)
+{
+    void* item;
+
+    if ((item = this->freeList))
+        this->freeList = *(void**)item;
+    else
+    {
+        if (this->cursor == this->end && ! addSlab(this))
+            return NULL;
+
+        item = this->cursor;
+        this->cursor += this->itemSize;
+    }
+
+    memset(item, 0, this->itemSize);
+
+    this->stats.allocations++;
+    this->stats.live++;
+    this->stats.peakLive = MAX(this->stats.peakLive, this->stats.live);
+
+    totals.allocations++;
+    totals.live++;
+    totals.peakLive = MAX(totals.peakLive, totals.live);
+
+    return item;
+}
+
+
+static void release(Pool* this, void* item)
+{
+    *(void**)item = this->freeList;
+    this->freeList = item;
+
+    this->stats.releases++;
+    this->stats.live--;
+
+    totals.releases++;
+    totals.live--;
+}
+
+
+static void destroy(Pool* this)
+{
+    void* slab;
+    Pool** iter;
+
+    while ((slab = this->slabs))
+    {
+        this->slabs = *(void**)slab;
+        free(slab);
+    }
+
+    totals.bytes -= this->stats.bytes;
+    totals.live -= this->stats.live;
+
+    for (iter = &pools; *iter; iter = &((*iter)->next))
+    {
+        if (*iter == this)
+        {
+            *iter = this->next;
+            break;
+        }
+    }
+}
+
+
+static bool addSlab(Pool* this)
+{
+    size_t header = POOL_ROUND(sizeof(void*));
+    size_t size = header + this->itemSize * this->slabItems;
+    char* slab;
+
+    if (! (slab = (char*)malloc(size)))
+    {
+        fprintf(stderr, ERR_POOL_MALLOC);
+        return false;
+    }
+
+    // Slabs are chained through their first word
+    *(void**)slab = this->slabs;
+    this->slabs = slab;
+
+    this->cursor = slab + header;
+    this->end = this->cursor + this->itemSize * this->slabItems;
+
+    this->stats.systemAllocations++;
+    this->stats.bytes += size;
+    this->stats.peakBytes = MAX(this->stats.peakBytes, this->stats.bytes);
+
+    totals.systemAllocations++;
+    totals.bytes += size;
+    totals.peakBytes = MAX(totals.peakBytes, totals.bytes);
+
+    return true;
+}
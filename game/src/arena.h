@@ -0,0 +1,60 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define ERR_POOL_MALLOC "Error: unable to allocate memory for pool\n"
+
+#define POOL_NAME_SIZE 32
+#define POOL_SLAB_ITEMS 64
+
+
+typedef struct PoolStats
+{
+    unsigned long allocations;
+    unsigned long releases;
+    unsigned long systemAllocations;
+
+    int live;
+    int peakLive;
+    size_t bytes;
+    size_t peakBytes;
+} PoolStats;
+
+
+// Fixed size items carved out of malloc'd slabs. Released items go on a free
+// list and are handed out again before a new slab is touched, and every slab
+// is freed at once when the pool is destroyed
+typedef struct Pool
+{
+    char name[POOL_NAME_SIZE];
+    size_t itemSize;
+    int slabItems;
+
+    void* slabs;
+    void* freeList;
+    char* cursor;
+    char* end;
+
+    PoolStats stats;
+    struct Pool* next;
+
+    // Where poolAlloc keeps this pool, cleared when freePools frees it
+    struct Pool** owner;
+
+    void* (*alloc)(struct Pool*);
+    void (*release)(struct Pool*, void*);
+    void (*destroy)(struct Pool*);
+} Pool;
+
+
+Pool* newPool(const char*, size_t, int);
+void* poolAlloc(Pool**, const char*, size_t);
+void poolRelease(Pool**, void*);
+void freePools(void);
+void getPoolTotals(PoolStats*);
+void logPools(FILE*);
+
+#endif
@@ -0,0 +1,262 @@
+#include <cglm/mat4.h>
+#include <cglm/vec3.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "box.h"
+#include "geometry.h"
+#include "list.h"
+#include "macros.h"
+#include "material.h"
+#include "renderer.h"
+#include "scene.h"
+#include "shader.h"
+#include "texture.h"
+
+#include "bake.h"
+
+
+// Baked geometry is registered by name, every batch needs its own
+static int batchNames = 0;
+
+static void linkMethods(BakedScene*);
+
+static void add(BakedScene*, Box*);
+static bool build(BakedScene*);
+static void draw(BakedScene*, Renderer*, Shader*);
+static void destroy(BakedScene*);
+
+static BakedBatch* findBatch(BakedScene*, Box*);
+static bool appendBox(BakedBatch*, Box*);
+static bool sameMaterial(Material*, Material*);
+
+
+BakedScene* newBakedScene()
+{
+    BakedScene* scene;
+
+    if (! (scene = (BakedScene*)malloc(sizeof(BakedScene))))
+    {
+        fprintf(stderr, ERR_BAKE_MALLOC);
+        return NULL;
+    }
+
+    memset(scene, 0, sizeof(BakedScene));
+    linkMethods(scene);
+
+    return scene;
+}
+
+
+static void linkMethods(BakedScene* this)
+{
+    this->add = add;
+    this->build = build;
+    this->draw = draw;
+    this->destroy = destroy;
+}
+
+
+static void add(BakedScene* this, Box* root)
+{
+    Scene* scene = root->scene;
+    BakedBatch* batch;
+    int end = SCENE_END(scene, root->index);
+
+    // Bake from the same world matrices the box would have been drawn with
+    scene->computeWorld(scene, root->index, end - root->index);
+
+    for (int i = root->index; i < end; i++)
+        if (! (batch = findBatch(this, scene->boxes[i])) ||
+            ! appendBox(batch, scene->boxes[i]))
+            return;
+}
+
+
+static bool build(BakedScene* this)
+{
+    BakedBatch* batch;
+    char name[GEOMETRY_NAME_SIZE];
+
+    for (int i = 0; i < this->count; i++)
+    {
+        batch = this->batches + i;
+
+        if (batch->geometry)
+            continue;
+
+        snprintf(name, GEOMETRY_NAME_SIZE, BAKE_NAME_FORMAT, batchNames++);
+
+        if (! (batch->geometry = acquireGeometry(name, batch->vertices,
+                                                 batch->vertexCount)))
+            return false;
+    }
+
+    return true;
+}
+
+
+static void draw(BakedScene* this, Renderer* renderer, Shader* shader)
+{
+    BakedBatch* batch;
+    RenderItem item;
+
+    for (int i = 0; i < this->count; i++)
+    {
+        batch = this->batches + i;
+
+        // Vertices are already in world space, so the geometry's bounds are
+        // too
+        if (! batch->geometry ||
+            ! renderer->isVisible(renderer, batch->geometry->bounds,
+                                  batch->boxes))
+            continue;
+
+        memset(&item, 0, sizeof(RenderItem));
+
+        item.shader = shader;
+        item.geometry = batch->geometry;
+        item.material = &(batch->material);
+        item.textureCount = batch->textureCount;
+        memcpy(item.textures, batch->textures, sizeof(batch->textures));
+        memcpy(item.layers, batch->layers, sizeof(batch->layers));
+        glm_mat4_identity(item.model);
+
+        renderer->submit(renderer, &item);
+    }
+}
+
+
+static void destroy(BakedScene* this)
+{
+    for (int i = 0; i < this->count; i++)
+    {
+        if (this->batches[i].geometry)
+            this->batches[i].geometry->release(this->batches[i].geometry);
+
+        SAFE_FREE(this->batches[i].vertices);
+    }
+
+    SAFE_FREE(this->batches);
+    this->count = 0;
+    this->size = 0;
+}
+
+
+static BakedBatch* findBatch(BakedScene* this, Box* box)
+{
+    BakedBatch* batch;
+    BakedBatch* temp;
+    ListNode* iter;
+    unsigned int textures[MAX_ITEM_TEXTURES];
+    int layers[MAX_ITEM_TEXTURES];
+    int textureCount = 0;
+    int cell[2];
+
+    LIST_FOR_EACH(box->textures, iter)
+    {
+        if (textureCount < MAX_ITEM_TEXTURES)
+        {
+            textures[textureCount] = ((Texture*)iter->value)->ID;
+            layers[textureCount++] = ((Texture*)iter->value)->layer;
+        }
+    }
+
+    cell[0] = (int)floorf(box->scene->world[box->index][3][X_COORD] /
+                          BAKE_CELL_SIZE);
+    cell[1] = (int)floorf(box->scene->world[box->index][3][Z_COORD] /
+                          BAKE_CELL_SIZE);
+
+    for (int i = 0; i < this->count; i++)
+    {
+        batch = this->batches + i;
+
+        if (! batch->geometry && batch->textureCount == textureCount &&
+            ! memcmp(batch->textures, textures,
+                     textureCount * sizeof(unsigned int)) &&
+            ! memcmp(batch->layers, layers, textureCount * sizeof(int)) &&
+            ! memcmp(batch->cell, cell, sizeof(cell)) &&
+            sameMaterial(&(batch->material), box->material))
+            return batch;
+    }
+
+    if (this->count == this->size)
+    {
+        if (! (temp = (BakedBatch*)realloc(this->batches,
+                                           MAX(this->size * 2, BAKE_BASE_SIZE) *
+                                           sizeof(BakedBatch))))
+        {
+            fprintf(stderr, ERR_BAKE_MALLOC);
+            return NULL;
+        }
+
+        this->batches = temp;
+        this->size = MAX(this->size * 2, BAKE_BASE_SIZE);
+    }
+
+    batch = this->batches + this->count++;
+    memset(batch, 0, sizeof(BakedBatch));
+
+    memcpy(&(batch->material), box->material, sizeof(Material));
+    memcpy(batch->textures, textures, textureCount * sizeof(unsigned int));
+    memcpy(batch->layers, layers, textureCount * sizeof(int));
+    memcpy(batch->cell, cell, sizeof(cell));
+    batch->textureCount = textureCount;
+
+    return batch;
+}
+
+
+static bool appendBox(BakedBatch* this, Box* box)
+{
+    Geometry* geometry = box->geometry;
+    vec4* world = box->scene->world[box->index];
+    float* temp;
+    float* src;
+    float* dest;
+    mat4 normal;
+
+    if (! (temp = (float*)realloc(this->vertices,
+                                  (this->vertexCount + geometry->vertexCount) *
+                                  VERTEX_SIZE * sizeof(float))))
+    {
+        fprintf(stderr, ERR_BAKE_MALLOC);
+        return false;
+    }
+
+    this->vertices = temp;
+
+    // Normals go through the inverse transpose, same as the vertex shader
+    glm_mat4_inv(world, normal);
+    glm_mat4_transpose(normal);
+
+    for (int i = 0; i < geometry->vertexCount; i++)
+    {
+        src = (float*)geometry->vertices + i * VERTEX_SIZE;
+        dest = this->vertices + (this->vertexCount + i) * VERTEX_SIZE;
+
+        glm_mat4_mulv3(world, src, 1.0f, dest);
+        glm_mat4_mulv3(normal, src + 3, 0.0f, dest + 3);
+        glm_vec3_normalize(dest + 3);
+
+        memcpy(dest + 6, src + 6, (VERTEX_SIZE - 6) * sizeof(float));
+    }
+
+    this->vertexCount += geometry->vertexCount;
+    this->boxes++;
+
+    return true;
+}
+
+
+static bool sameMaterial(Material* a, Material* b)
+{
+    return glm_vec3_eqv(a->ambient, b->ambient) &&
+           a->diffuse == b->diffuse &&
+           a->specular == b->specular &&
+           a->shininess == b->shininess;
+}
@@ -0,0 +1,55 @@
+#ifndef BAKE_H
+#define BAKE_H
+
+#include <stdbool.h>
+
+#include "box.h"
+#include "geometry.h"
+#include "material.h"
+#include "renderer.h"
+#include "shader.h"
+
+#define ERR_BAKE_MALLOC "Error: unable to allocate memory for baked geometry\n"
+
+#define BAKE_BASE_SIZE 16
+#define BAKE_NAME_FORMAT "baked_%d"
+
+// Boxes are also grouped by which cell of this size their centre falls in, so
+// large models such as the ground still get culled in pieces
+#define BAKE_CELL_SIZE 50.0f
+
+
+// Every static box sharing a material, texture set and cell, pre-transformed
+// into world space and drawn as one
+typedef struct BakedBatch
+{
+    Material material;
+    unsigned int textures[MAX_ITEM_TEXTURES];
+    int layers[MAX_ITEM_TEXTURES];
+    int textureCount;
+    int cell[2];
+
+    float* vertices;
+    int vertexCount;
+    int boxes;
+
+    Geometry* geometry;
+} BakedBatch;
+
+
+typedef struct BakedScene
+{
+    BakedBatch* batches;
+    int count;
+    int size;
+
+    void (*add)(struct BakedScene*, Box*);
+    bool (*build)(struct BakedScene*);
+    void (*draw)(struct BakedScene*, Renderer*, Shader*);
+    void (*destroy)(struct BakedScene*);
+} BakedScene;
+
+
+BakedScene* newBakedScene(void);
+
+#endif
@@ -0,0 +1,689 @@
+#include <glad/glad.h>
+
+#ifdef GAME_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cglm/util.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "box.h"
+#include "bvh.h"
+#include "camera.h"
+#include "grid.h"
+#include "macros.h"
+#include "renderer.h"
+#include "scene.h"
+#include "timer.h"
+
+#include "bench.h"
+
+
+static void linkMethods(Bench*);
+
+static bool initContext(Bench*, Backend*);
+static bool run(Bench*, Backend*);
+static bool writeReport(Bench*);
+static void destroy(Bench*);
+
+static void followPath(Bench*, Backend*, int);
+static bool compareColliders(Bench*);
+static bool compareRays(Bench*);
+static bool rayBox(vec3*, vec3, vec3, float, float*);
+static float randomUnit(unsigned int*);
+static void summarise(FILE*, const char*, double*, int, bool);
+static int compareDoubles(const void*, const void*);
+
+
+Bench* newBench(int argc, char** argv)
+{
+    Bench* bench;
+    int frames = BENCH_FRAMES;
+    const char* output = BENCH_OUTPUT;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (! strcmp(argv[i], BENCH_FRAMES_FLAG) && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (! strcmp(argv[i], BENCH_OUTPUT_FLAG) && i + 1 < argc)
+            output = argv[++i];
+        else
+            frames = 0;
+    }
+
+    // Unknown arguments also end up here
+    if (frames <= 0)
+    {
+        fprintf(stderr, ERR_BENCH_ARGS);
+        return NULL;
+    }
+
+#ifndef GAME_HAS_EGL
+    fprintf(stderr, ERR_BENCH_UNSUPPORTED);
+    return NULL;
+#endif
+
+    if (! (bench = (Bench*)malloc(sizeof(Bench))))
+    {
+        fprintf(stderr, ERR_BENCH_MALLOC);
+        return NULL;
+    }
+
+    memset(bench, 0, sizeof(Bench));
+    linkMethods(bench);
+
+    bench->frames = frames;
+    strncpy(bench->output, output, BUFSIZ - 1);
+
+    if (! (bench->results = (BenchFrame*)calloc(frames, sizeof(BenchFrame))))
+    {
+        fprintf(stderr, ERR_BENCH_MALLOC);
+        SAFE_FREE(bench);
+        return NULL;
+    }
+
+    return bench;
+}
+
+
+static void linkMethods(Bench* this)
+{
+    this->initContext = initContext;
+    this->run = run;
+    this->writeReport = writeReport;
+    this->destroy = destroy;
+}
+
+
+static bool initContext(Bench* this, Backend* engine)
+{
+#ifdef GAME_HAS_EGL
+    EGLDisplay display;
+    EGLContext context;
+
+    EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    // Surfaceless, so no window system or GPU is needed, Mesa's llvmpipe
+    // is enough
+    display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, NULL);
+
+    if (display == EGL_NO_DISPLAY || ! eglInitialize(display, NULL, NULL) ||
+        ! eglBindAPI(EGL_OPENGL_API))
+    {
+        fprintf(stderr, ERR_BENCH_EGL);
+        return false;
+    }
+
+    this->display = display;
+    context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+                               attributes);
+
+    if (context == EGL_NO_CONTEXT ||
+        ! eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        fprintf(stderr, ERR_BENCH_EGL);
+        return false;
+    }
+
+    this->context = context;
+
+    if (! gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        fprintf(stderr, ERR_GLAD);
+        return false;
+    }
+
+    // Stands in for the window's default framebuffer
+    glGenFramebuffers(1, &(this->FBO));
+    glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+
+    glGenRenderbuffers(1, &(this->colorRBO));
+    glBindRenderbuffer(GL_RENDERBUFFER, this->colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, this->colorRBO);
+
+    glGenRenderbuffers(1, &(this->depthRBO));
+    glBindRenderbuffer(GL_RENDERBUFFER, this->depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WIDTH, HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, this->depthRBO);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, ERR_BENCH_FBO);
+        return false;
+    }
+
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glGenQueries(BENCH_QUERIES, this->queries);
+
+    engine->width = WIDTH;
+    engine->height = HEIGHT;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+static bool run(Bench* this, Backend* engine)
+{
+    BenchFrame* frame;
+    GLuint64 elapsed;
+    Scene* scene = getBoxScene();
+    double start;
+    int first;
+    bool passed;
+
+    if (! engine || ! engine->renderer)
+        return false;
+
+    // Same frame sequence every run
+    setFixedTimestep(BENCH_TIMESTEP);
+    followPath(this, engine, 0);
+    takeSnapshot(engine, &(engine->current));
+
+    // Untimed frames so that first use uploads and the driver's first query
+    // results stay out of the report
+    for (int i = 0; i < BENCH_WARMUP; i++)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, this->queries[i % BENCH_QUERIES]);
+        drawFrame(engine, &(engine->current));
+        glEndQuery(GL_TIME_ELAPSED);
+        glGetQueryObjectui64v(this->queries[i % BENCH_QUERIES],
+                              GL_QUERY_RESULT, &elapsed);
+    }
+
+    this->wallTime = getWallTime();
+
+    for (int i = 0; i < this->frames; i++)
+    {
+        frame = this->results + i;
+
+        // One simulation step per frame, timed on its own, then the path
+        // puts the camera where this frame needs it
+        advanceTime();
+
+        start = getWallTime();
+        update(engine, BENCH_TIMESTEP);
+        frame->update = (getWallTime() - start) * 1000.0;
+
+        followPath(this, engine, i);
+        takeSnapshot(engine, &(engine->current));
+
+        start = getWallTime();
+        glBeginQuery(GL_TIME_ELAPSED, this->queries[i % BENCH_QUERIES]);
+
+        drawFrame(engine, &(engine->current));
+
+        glEndQuery(GL_TIME_ELAPSED);
+        frame->cpu = (getWallTime() - start) * 1000.0;
+
+        frame->drawCalls = engine->renderer->stats.drawCalls;
+        frame->stateChanges = engine->renderer->stats.stateChanges;
+        frame->textureBinds = engine->renderer->stats.textureChanges;
+        frame->culled = engine->renderer->stats.culled;
+        frame->matrices = scene->stats.recomputed;
+        frame->vertices = engine->renderer->stats.vertices;
+        frame->vertexBytes = engine->renderer->stats.vertexBytes;
+
+        // Oldest query in the ring, BENCH_QUERIES - 1 frames behind
+        if ((first = i - BENCH_QUERIES + 1) >= 0)
+        {
+            glGetQueryObjectui64v(this->queries[first % BENCH_QUERIES],
+                                  GL_QUERY_RESULT, &elapsed);
+            this->results[first].gpu = elapsed / 1.0e6;
+        }
+    }
+
+    for (int i = MAX(this->frames - BENCH_QUERIES + 1, 0); i < this->frames; i++)
+    {
+        glGetQueryObjectui64v(this->queries[i % BENCH_QUERIES],
+                              GL_QUERY_RESULT, &elapsed);
+        this->results[i].gpu = elapsed / 1.0e6;
+    }
+
+    glFinish();
+    this->wallTime = getWallTime() - this->wallTime;
+
+    // Both comparisons always run so the report has every number, even when
+    // one of them disagrees
+    passed = compareColliders(this);
+    passed = compareRays(this) && passed;
+
+    return this->writeReport(this) && passed;
+}
+
+
+static bool writeReport(Bench* this)
+{
+    FILE* f;
+    double* values;
+    double cpu = 0.0;
+    double gpu = 0.0;
+    double update = 0.0;
+
+    if (! (values = (double*)malloc(this->frames * sizeof(double))))
+    {
+        fprintf(stderr, ERR_BENCH_MALLOC);
+        return false;
+    }
+
+    if (! (f = fopen(this->output, "w")))
+    {
+        fprintf(stderr, ERR_BENCH_REPORT, this->output);
+        SAFE_FREE(values);
+        return false;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "    \"frames\": %d,\n", this->frames);
+    fprintf(f, "    \"width\": %d,\n", WIDTH);
+    fprintf(f, "    \"height\": %d,\n", HEIGHT);
+    fprintf(f, "    \"timestep\": %f,\n", BENCH_TIMESTEP);
+    fprintf(f, "    \"renderer\": \"%s\",\n",
+            (const char*)glGetString(GL_RENDERER));
+    fprintf(f, "    \"wall_seconds\": %f,\n", this->wallTime);
+    fprintf(f, "    \"colliders\": %d,\n", this->colliders);
+    fprintf(f, "    \"grid_probe_us\": %f,\n", this->gridTime);
+    fprintf(f, "    \"brute_probe_us\": %f,\n", this->bruteTime);
+    fprintf(f, "    \"ray_boxes\": %d,\n", this->rayBoxes);
+    fprintf(f, "    \"bvh_rays_per_second\": %f,\n", this->bvhRays);
+    fprintf(f, "    \"bvh_scalar_rays_per_second\": %f,\n", this->scalarRays);
+    fprintf(f, "    \"brute_rays_per_second\": %f,\n", this->bruteRays);
+
+    for (int i = 0; i < this->frames; i++)
+        cpu += values[i] = this->results[i].cpu;
+    summarise(f, "cpu_ms", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        gpu += values[i] = this->results[i].gpu;
+    summarise(f, "gpu_ms", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        update += values[i] = this->results[i].update;
+    summarise(f, "update_ms", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].drawCalls;
+    summarise(f, "draw_calls", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].stateChanges;
+    summarise(f, "state_changes", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].textureBinds;
+    summarise(f, "texture_binds", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].culled;
+    summarise(f, "boxes_culled", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].matrices;
+    summarise(f, "matrices_recomputed", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].vertices;
+    summarise(f, "vertices", values, this->frames, false);
+
+    for (int i = 0; i < this->frames; i++)
+        values[i] = this->results[i].vertexBytes;
+    summarise(f, "vertex_bytes", values, this->frames, true);
+
+    fprintf(f, "}\n");
+    fclose(f);
+    SAFE_FREE(values);
+
+    printf("Benchmark: %d frames, %.3f ms cpu, %.3f ms gpu, %.3f ms update "
+           "per frame, report written to %s\n", this->frames,
+           cpu / this->frames, gpu / this->frames, update / this->frames,
+           this->output);
+    printf("Colliders: %d, %.3f us per probe through the grid, %.3f us "
+           "testing each\n", this->colliders, this->gridTime, this->bruteTime);
+    printf("Rays: %d boxes, %.0f rays/s through the BVH, %.0f without SIMD, "
+           "%.0f testing each\n", this->rayBoxes, this->bvhRays,
+           this->scalarRays, this->bruteRays);
+
+    // Per pool breakdown of what the windowed info line only totals
+    logPools(stdout);
+
+    return true;
+}
+
+
+static void destroy(Bench* this)
+{
+#ifdef GAME_HAS_EGL
+    if (this->context)
+    {
+        glDeleteQueries(BENCH_QUERIES, this->queries);
+        glDeleteRenderbuffers(1, &(this->colorRBO));
+        glDeleteRenderbuffers(1, &(this->depthRBO));
+        glDeleteFramebuffers(1, &(this->FBO));
+
+        eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        eglDestroyContext(this->display, this->context);
+    }
+
+    if (this->display)
+        eglTerminate(this->display);
+#endif
+
+    SAFE_FREE(this->results);
+}
+
+
+static void followPath(Bench* this, Backend* engine, int frame)
+{
+    Camera* cam = engine->cam;
+    float angle = 2.0f * GLM_PIf * frame / this->frames;
+    float yaw = glm_deg(angle) + 180.0f;
+
+    // One lap around the scene looking at its centre, with the wolf
+    // picked up for the second half so the sheep and traps are drawn too
+    cam->setPosition(cam, (vec3){BENCH_PATH_RADIUS * cosf(angle),
+                                 BENCH_PATH_HEIGHT,
+                                 BENCH_PATH_RADIUS * sinf(angle)});
+    cam->moveMouse(cam, (yaw - cam->yaw) / cam->mouseSensitivity,
+                   -cam->pitch / cam->mouseSensitivity, true);
+
+    engine->options[GAME_PICKUP_WOLF] = frame >= this->frames / 2;
+    engine->options[GAME_PLAYER_DIE] = false;
+    engine->options[GAME_WIN] = false;
+}
+
+
+static bool compareColliders(Bench* this)
+{
+    int side = BENCH_COLLIDER_SIDE;
+    int count = side * side;
+    float extent = (float)(side * TRAP_SPACING) / 2.0f;
+    int hits[BENCH_MAX_HITS];
+    unsigned int seed = 1;
+    int mismatches = 0;
+    int brute;
+    int found;
+    double start;
+
+    vec3* traps;
+    vec3* probes;
+    int* expected;
+    Grid* grid;
+
+    traps = (vec3*)malloc(count * sizeof(vec3));
+    probes = (vec3*)malloc(BENCH_PROBES * sizeof(vec3));
+    expected = (int*)malloc(BENCH_PROBES * sizeof(int));
+
+    if (! traps || ! probes || ! expected || ! (grid = newGrid(COLLIDER_CELL_SIZE)))
+    {
+        fprintf(stderr, ERR_BENCH_MALLOC);
+        SAFE_FREE(traps);
+        SAFE_FREE(probes);
+        SAFE_FREE(expected);
+        return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        glm_vec3_copy((vec3){(float)(i % side * TRAP_SPACING) - extent, 0.0f,
+                             (float)(i / side * TRAP_SPACING) - extent},
+                      traps[i]);
+        grid->add(grid, traps[i], TRAP_RADIUS, COLLIDE_TRAP);
+    }
+
+    // Same points every run
+    for (int i = 0; i < BENCH_PROBES; i++)
+        for (int j = 0; j < 3; j++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            probes[i][j] = j == Y_COORD ? 0.0f :
+                ((float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f) * extent;
+        }
+
+    // Every trap, as checkHitbox used to
+    start = getWallTime();
+    for (int i = 0; i < BENCH_PROBES; i++)
+    {
+        brute = 0;
+        for (int j = 0; j < count; j++)
+            brute += glm_vec3_distance(probes[i], traps[j]) < TRAP_RADIUS;
+
+        expected[i] = MIN(brute, BENCH_MAX_HITS);
+    }
+    this->bruteTime = (getWallTime() - start) * 1.0e6 / BENCH_PROBES;
+
+    start = getWallTime();
+    for (int i = 0; i < BENCH_PROBES; i++)
+    {
+        found = grid->queryRadius(grid, probes[i], 0.0f, COLLIDE_TRAP, hits,
+                                  BENCH_MAX_HITS);
+        mismatches += found != expected[i];
+    }
+    this->gridTime = (getWallTime() - start) * 1.0e6 / BENCH_PROBES;
+
+    this->colliders = count;
+
+    if (mismatches)
+        fprintf(stderr, ERR_BENCH_COLLIDERS, mismatches, BENCH_PROBES);
+
+    grid->destroy(grid);
+    SAFE_FREE(grid);
+    SAFE_FREE(traps);
+    SAFE_FREE(probes);
+    SAFE_FREE(expected);
+
+    return ! mismatches;
+}
+
+
+static bool compareRays(Bench* this)
+{
+    unsigned int seed = 1;
+    int mismatches = 0;
+    int nearest;
+    bool simd;
+    float best;
+    float t;
+    double start;
+    vec3 center;
+    vec3 inverse;
+
+    vec3 (*boxes)[2];
+    vec3 (*rays)[2];
+    int* items;
+    float* expected;
+    Bvh* bvh;
+
+    boxes = (vec3(*)[2])malloc(BENCH_RAY_BOXES * sizeof(vec3[2]));
+    rays = (vec3(*)[2])malloc(BENCH_RAYS * sizeof(vec3[2]));
+    items = (int*)malloc(BENCH_RAY_BOXES * sizeof(int));
+    expected = (float*)malloc(BENCH_RAYS * sizeof(float));
+
+    if (! boxes || ! rays || ! items || ! expected || ! (bvh = newBvh()))
+    {
+        fprintf(stderr, ERR_BENCH_MALLOC);
+        SAFE_FREE(boxes);
+        SAFE_FREE(rays);
+        SAFE_FREE(items);
+        SAFE_FREE(expected);
+        return false;
+    }
+
+    // Same boxes and rays every run, boxes between a quarter and one and a
+    // quarter units across
+    for (int i = 0; i < BENCH_RAY_BOXES; i++)
+    {
+        center[X_COORD] = randomUnit(&seed) * BENCH_RAY_EXTENT / 2.0f;
+        center[Y_COORD] = randomUnit(&seed) * BENCH_RAY_HEIGHT / 2.0f;
+        center[Z_COORD] = randomUnit(&seed) * BENCH_RAY_EXTENT / 2.0f;
+
+        for (int j = 0; j < 3; j++)
+        {
+            t = 0.375f + randomUnit(&seed) * 0.25f;
+            boxes[i][0][j] = center[j] - t;
+            boxes[i][1][j] = center[j] + t;
+        }
+
+        items[i] = i;
+    }
+
+    for (int i = 0; i < BENCH_RAYS; i++)
+    {
+        rays[i][0][X_COORD] = randomUnit(&seed) * BENCH_RAY_EXTENT / 2.0f;
+        rays[i][0][Y_COORD] = randomUnit(&seed) * BENCH_RAY_HEIGHT / 2.0f;
+        rays[i][0][Z_COORD] = randomUnit(&seed) * BENCH_RAY_EXTENT / 2.0f;
+
+        for (int j = 0; j < 3; j++)
+            rays[i][1][j] = randomUnit(&seed);
+
+        glm_vec3_normalize(rays[i][1]);
+    }
+
+    if (! bvh->build(bvh, boxes, items, BENCH_RAY_BOXES))
+    {
+        bvh->destroy(bvh);
+        SAFE_FREE(bvh);
+        SAFE_FREE(boxes);
+        SAFE_FREE(rays);
+        SAFE_FREE(items);
+        SAFE_FREE(expected);
+        return false;
+    }
+
+    // Every box, nearest hit kept
+    start = getWallTime();
+    for (int i = 0; i < BENCH_RAYS; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            inverse[j] = 1.0f / rays[i][1][j];
+
+        best = BENCH_RAY_REACH;
+        nearest = BVH_MISS;
+
+        for (int j = 0; j < BENCH_RAY_BOXES; j++)
+            if (rayBox(boxes[j], rays[i][0], inverse, best, &t))
+            {
+                best = t;
+                nearest = j;
+            }
+
+        expected[i] = nearest == BVH_MISS ? -1.0f : best;
+    }
+    this->bruteRays = BENCH_RAYS / (getWallTime() - start);
+
+    // Scalar first, then SIMD where built in. Ties between boxes may pick
+    // either, so the distances are compared rather than the boxes
+    simd = bvh->simd;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bvh->simd = pass && simd;
+
+        start = getWallTime();
+        for (int i = 0; i < BENCH_RAYS; i++)
+        {
+            nearest = bvh->raycast(bvh, rays[i][0], rays[i][1],
+                                   BENCH_RAY_REACH, &t);
+
+            if (nearest == BVH_MISS ? expected[i] >= 0.0f
+                                    : fabsf(t - expected[i]) > 1.0e-4f)
+                mismatches++;
+        }
+
+        if (pass)
+            this->bvhRays = BENCH_RAYS / (getWallTime() - start);
+        else
+            this->scalarRays = BENCH_RAYS / (getWallTime() - start);
+    }
+
+    this->rayBoxes = BENCH_RAY_BOXES;
+
+    if (mismatches)
+        fprintf(stderr, ERR_BENCH_RAYS, mismatches, 2 * BENCH_RAYS);
+
+    bvh->destroy(bvh);
+    SAFE_FREE(bvh);
+    SAFE_FREE(boxes);
+    SAFE_FREE(rays);
+    SAFE_FREE(items);
+    SAFE_FREE(expected);
+
+    return ! mismatches;
+}
+
+
+static bool rayBox(vec3* bounds, vec3 origin, vec3 inverse, float reach,
+                   float* distance)
+{
+    float near = 0.0f;
+    float far = reach;
+    float low;
+    float high;
+
+    for (int i = 0; i < 3; i++)
+    {
+        low = (bounds[0][i] - origin[i]) * inverse[i];
+        high = (bounds[1][i] - origin[i]) * inverse[i];
+
+        near = MAX(near, MIN(low, high));
+        far = MIN(far, MAX(low, high));
+    }
+
+    *distance = near;
+
+    return near <= far;
+}
+
+
+// Between -1 and 1
+static float randomUnit(unsigned int* seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+
+    return (float)(*seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+
+static void summarise(FILE* f, const char* name, double* values, int count,
+                      bool last)
+{
+    double total = 0.0;
+
+    qsort(values, count, sizeof(double), compareDoubles);
+
+    for (int i = 0; i < count; i++)
+        total += values[i];
+
+    fprintf(f, "    \"%s\": {\"mean\": %f, \"min\": %f, \"p50\": %f, "
+               "\"p95\": %f, \"p99\": %f, \"max\": %f}%s\n",
+            name, total / count, values[0], values[(int)(0.5 * (count - 1))],
+            values[(int)(0.95 * (count - 1))],
+            values[(int)(0.99 * (count - 1))], values[count - 1],
+            last ? "" : ",");
+}
+
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
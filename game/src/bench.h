@@ -0,0 +1,103 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "game.h"
+
+#define BENCH_FLAG "--bench"
+#define BENCH_FRAMES_FLAG "--frames"
+#define BENCH_OUTPUT_FLAG "--output"
+
+#define BENCH_FRAMES 600
+#define BENCH_OUTPUT "bench.json"
+#define BENCH_TIMESTEP (1.0 / 60.0)
+
+// Frames drawn before timing starts
+#define BENCH_WARMUP 8
+
+// Timer queries in flight before the oldest one is read back
+#define BENCH_QUERIES 4
+
+// Scripted path, one lap around the scene at this radius and height
+#define BENCH_PATH_RADIUS 30.0f
+#define BENCH_PATH_HEIGHT 0.0f
+
+// Collision comparison, a square field of traps TRAP_SPACING apart probed at
+// pseudo random points, through the spatial grid and by testing every trap
+#define BENCH_COLLIDER_SIDE 100
+#define BENCH_PROBES 20000
+#define BENCH_MAX_HITS 16
+
+// Picking comparison, pseudo random boxes in a flat volume hit by pseudo
+// random rays, through the BVH with and without SIMD and by testing every box
+#define BENCH_RAY_BOXES 4096
+#define BENCH_RAY_EXTENT 100.0f
+#define BENCH_RAY_HEIGHT 10.0f
+#define BENCH_RAY_REACH 50.0f
+#define BENCH_RAYS 20000
+
+#define ERR_BENCH_MALLOC "Error: unable to allocate memory for benchmark\n"
+#define ERR_BENCH_ARGS "Usage: game --bench [--frames N] [--output FILE]\n"
+#define ERR_BENCH_EGL "Error: unable to create offscreen EGL context\n"
+#define ERR_BENCH_FBO "Error: offscreen framebuffer is incomplete\n"
+#define ERR_BENCH_UNSUPPORTED "Error: built without EGL, benchmark mode unavailable\n"
+#define ERR_BENCH_COLLIDERS "Error: spatial grid and brute force disagree on %d of %d probes\n"
+#define ERR_BENCH_RAYS "Error: BVH and brute force disagree on %d of %d rays\n"
+#define ERR_BENCH_REPORT "Error: unable to write benchmark report \"%s\"\n"
+
+
+typedef struct BenchFrame
+{
+    double cpu;
+    double gpu;
+    double update;
+    unsigned int drawCalls;
+    unsigned int stateChanges;
+    unsigned int textureBinds;
+    unsigned int culled;
+    unsigned int matrices;
+    unsigned int vertices;
+    unsigned int vertexBytes;
+} BenchFrame;
+
+
+typedef struct Bench
+{
+    int frames;
+    char output[BUFSIZ];
+
+    // Opaque EGL handles so EGL stays out of the header
+    void* display;
+    void* context;
+
+    unsigned int FBO;
+    unsigned int colorRBO;
+    unsigned int depthRBO;
+    unsigned int queries[BENCH_QUERIES];
+
+    BenchFrame* results;
+    double wallTime;
+
+    // Microseconds per probe
+    int colliders;
+    double gridTime;
+    double bruteTime;
+
+    // Rays per second
+    int rayBoxes;
+    double bvhRays;
+    double scalarRays;
+    double bruteRays;
+
+    bool (*initContext)(struct Bench*, Backend*);
+    bool (*run)(struct Bench*, Backend*);
+    bool (*writeReport)(struct Bench*);
+    void (*destroy)(struct Bench*);
+} Bench;
+
+
+Bench* newBench(int, char**);
+
+#endif
@@ -4,78 +4,43 @@
 #include <cglm/vec3.h>
 #include <cglm/mat4.h>
 #include <cglm/affine.h>
+#include <cglm/box.h>
 #include <cglm/io.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 
+#include "arena.h"
+#include "geometry.h"
 #include "list.h"
 #include "macros.h"
 #include "material.h"
+#include "renderer.h"
+#include "scene.h"
 #include "shader.h"
 #include "texture.h"
 
 #include "box.h"
 
 
-static float VERTICES[] = {
-    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
-     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-
-    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-
-    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-
-     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-     0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-
-    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
-     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-
-    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-     0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
-};
-
+// Transform storage and struct storage shared by every box
+static Scene* scene = NULL;
+static Pool* boxPool = NULL;
 
 static void linkMethods(Box*);
-static void setGlBuffers(Box*);
 
 static void attach(Box*, Box*);
 
 static void setShader(Box*, Shader*);
+static void setRenderer(Box*, Renderer*);
 static void addTexture(Box*, Texture*);
 static void setModelPosition(Box*, vec3);
 static void setPosition(Box*, vec3);
 static void setScale(Box*, vec3);
 static void setRotation(Box*, vec3);
 static void setRotationDelta(Box*, vec3);
+static void setMatrixCallback(Box*, void (*)(Box*, mat4, void*));
 
 static void recordInitialPosition(Box*);
 static void recordInitialRotation(Box*);
@@ -84,31 +49,49 @@ static void resetRotation(Box*);
 
 static void move(Box*, vec3);
 static void transformPosition(Box*, mat4);
+static void assignTransform(Scene*, int, vec3, vec3);
+static void addTransform(Scene*, int, vec3, vec3);
 
 static void draw(Box*, void*);
-static void setupShader(Box*);
-static void setupTexture(Box*);
+static void drawInstanced(Box*, mat4*, int, void*);
+static void drawParts(Box*, int, int, void*);
+static void submit(Box*, int, int, void*);
 static void setupModelMatrix(Box*, mat4, void*);
 static void destroy(Box*);
+static void release(Box*);
 
 
 Box* newBox(vec3 modelPosition)
 {
     Box* box;
 
-    if (! (box = (Box*)malloc(sizeof(Box))))
+    if (! scene && ! (scene = newScene()))
+        return NULL;
+
+    if (! (box = (Box*)poolAlloc(&boxPool, "boxes", sizeof(Box))))
     {
         fprintf(stderr, ERR_BOX_MALLOC);
         return NULL;
     }
 
-    memset(box, 0, sizeof(Box));
     linkMethods(box);
 
+    if (scene->add(scene, box) < 0)
+    {
+        poolRelease(&boxPool, box);
+        return NULL;
+    }
+
+    box->scene = scene;
     box->textures = newList();
-    box->attached = newList();
+    box->geometry = acquireCube();
+
+    if (! box->geometry)
+    {
+        box->destroy(box);
+        return NULL;
+    }
 
-    setGlBuffers(box);
     box->setModelPosition(box, modelPosition);
     box->setScale(box, NULL);
     box->setRotation(box, NULL);
@@ -117,8 +100,7 @@ Box* newBox(vec3 modelPosition)
 
     if (! box->material)
     {
-        box->textures->deleteListShallow(&(box->textures));
-        free(box);
+        box->destroy(box);
         return NULL;
     }
 
@@ -126,16 +108,38 @@ Box* newBox(vec3 modelPosition)
 }
 
 
+Scene* getBoxScene()
+{
+    return scene;
+}
+
+
+// Boxes, their texture lists and materials all live in pools, freePools
+// takes them a slab at a time once the scene and geometry are gone
+void deleteBoxes()
+{
+    if (scene)
+    {
+        scene->destroy(scene);
+        SAFE_FREE(scene);
+    }
+
+    deleteGeometries();
+}
+
+
 static void linkMethods(Box* this)
 {
     this->attach = attach;
     this->setShader = setShader;
+    this->setRenderer = setRenderer;
     this->addTexture = addTexture;
     this->setModelPosition = setModelPosition;
     this->setPosition = setPosition;
     this->setScale = setScale;
     this->setRotation = setRotation;
     this->setRotationDelta = setRotationDelta;
+    this->setMatrixCallback = setMatrixCallback;
 
     this->recordInitialPosition = recordInitialPosition;
     this->recordInitialRotation = recordInitialRotation;
@@ -146,8 +150,7 @@ static void linkMethods(Box* this)
     this->transformPosition = transformPosition;
 
     this->draw = draw;
-    this->setupShader = setupShader;
-    this->setupTexture = setupTexture;
+    this->drawInstanced = drawInstanced;
     this->setupModelMatrix = setupModelMatrix;
     this->destroy = destroy;
 }
@@ -155,39 +158,20 @@ static void linkMethods(Box* this)
 
 static void attach(Box* this, Box* attach)
 {
-    this->attached->insertLast(this->attached, attach, true);
+    this->scene->attach(this->scene, this->index, attach->index);
 }
 
 
-static void setGlBuffers(Box* this)
+static void setShader(Box* this, Shader* shader)
 {
-    // Make VAO and VBO buffers
-    glGenVertexArrays(1, &(this->VAO));
-    glGenBuffers(1, &(this->VBO));
-
-    glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(VERTICES), VERTICES, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                          (void*)(3 * sizeof(float)));
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                          (void*)(6 * sizeof(float)));
-
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    this->shader = shader;
 }
 
 
-static void setShader(Box* this, Shader* shader)
+static void setRenderer(Box* this, Renderer* renderer)
 {
-    this->shader = shader;
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        this->scene->boxes[i]->renderer = renderer;
 }
 
 
@@ -200,16 +184,16 @@ static void addTexture(Box* this, Texture* texture)
 static void setModelPosition(Box* this, vec3 modelPosition)
 {
     // Model Position is the position of the box relative to the model
-    ListNode* iter;
     vec3 delta;
 
     glm_vec3_sub(modelPosition, this->modelPosition, delta);
 
-    glm_vec3_copy(modelPosition ? modelPosition : (vec3){0.0f, 0.0f, 0.0f},
-                  this->modelPosition);
+    assignTransform(this->scene, this->index,
+                    modelPosition ? modelPosition : (vec3){0.0f, 0.0f, 0.0f},
+                    this->modelPosition);
 
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->move((Box*)(iter->value), delta);
+    for (int i = this->index + 1; i < SCENE_END(this->scene, this->index); i++)
+        addTransform(this->scene, i, delta, this->scene->position[i]);
 }
 
 
@@ -217,200 +201,280 @@ static void setPosition(Box* this, vec3 position)
 {
     // Position is the position of the box relative to the world, added to the
     // model position
-    ListNode* iter;
     vec3 delta;
 
     glm_vec3_sub(position, this->position, delta);
 
-    glm_vec3_copy(position ? position : (vec3){0.0f, 0.0f, 0.0f},
-                  this->position);
+    assignTransform(this->scene, this->index,
+                    position ? position : (vec3){0.0f, 0.0f, 0.0f},
+                    this->position);
 
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->move((Box*)(iter->value), delta);
+    for (int i = this->index + 1; i < SCENE_END(this->scene, this->index); i++)
+        addTransform(this->scene, i, delta, this->scene->position[i]);
 }
 
 
 static void setScale(Box* this, vec3 scale)
 {
-    glm_vec3_copy(scale ? scale : (vec3){1.0f, 1.0f, 1.0f},
-                  this->scale);
+    assignTransform(this->scene, this->index,
+                    scale ? scale : (vec3){1.0f, 1.0f, 1.0f},
+                    this->scale);
 }
 
 
 static void setRotation(Box* this, vec3 rotation)
 {
-    ListNode* iter;
-
-    glm_vec3_copy(rotation ? rotation : (vec3){0.0f, 0.0f, 0.0f},
-                  this->rotation);
-
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->setRotation((Box*)(iter->value), rotation);
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        assignTransform(this->scene, i,
+                        rotation ? rotation : (vec3){0.0f, 0.0f, 0.0f},
+                        this->scene->rotation[i]);
 }
 
 
 static void setRotationDelta(Box* this, vec3 rotation)
 {
-    ListNode* iter;
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        addTransform(this->scene, i,
+                     rotation ? rotation : (vec3){0.0f, 0.0f, 0.0f},
+                     this->scene->rotation[i]);
+}
 
-    glm_vec3_add(rotation ? rotation : (vec3){0.0f, 0.0f, 0.0f},
-                 this->rotation, this->rotation);
 
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->setRotationDelta((Box*)(iter->value), rotation);
+static void setMatrixCallback(Box* this, void (*callback)(Box*, mat4, void*))
+{
+    this->setupModelMatrix = callback ? callback : setupModelMatrix;
+
+    // Bounds are loosened to cover whatever rotation the callback applies
+    this->scene->animated[this->index] = callback != NULL;
+    this->scene->dirty[this->index] = true;
 }
 
 
 static void recordInitialPosition(Box* this)
 {
-    ListNode* iter;
-    glm_vec3_copy(this->position, this->initialPosition);
-
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->recordInitialPosition((Box*)(iter->value));
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        glm_vec3_copy(this->scene->position[i],
+                      this->scene->initialPosition[i]);
 }
 
 
 static void recordInitialRotation(Box* this)
 {
-    ListNode* iter;
-    glm_vec3_copy(this->rotation, this->initialRotation);
-
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->recordInitialRotation((Box*)(iter->value));
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        glm_vec3_copy(this->scene->rotation[i],
+                      this->scene->initialRotation[i]);
 }
 
 
 static void resetPosition(Box* this)
 {
-    ListNode* iter;
-    this->setPosition(this, this->initialPosition);
-
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->resetPosition((Box*)(iter->value));
+    // Every box in the subtree ends up back at its own initial position
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        assignTransform(this->scene, i, this->scene->initialPosition[i],
+                        this->scene->position[i]);
 }
 
 
 static void resetRotation(Box* this)
 {
-    ListNode* iter;
-    this->setRotation(this, this->initialRotation);
-
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->resetRotation((Box*)(iter->value));
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        assignTransform(this->scene, i, this->scene->initialRotation[i],
+                        this->scene->rotation[i]);
 }
 
 
 static void move(Box* this, vec3 delta)
 {
-    ListNode* iter;
-    glm_vec3_add(delta, this->position, this->position);
-
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->move((Box*)(iter->value), delta);
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+        addTransform(this->scene, i, delta, this->scene->position[i]);
 }
 
 
 static void transformPosition(Box* this, mat4 transform)
 {
-    ListNode* iter;
-    glm_mat4_mulv3(transform, this->position, 1.0f, this->position);
+    vec3 position;
+
+    for (int i = this->index; i < SCENE_END(this->scene, this->index); i++)
+    {
+        glm_mat4_mulv3(transform, this->scene->position[i], 1.0f, position);
+        assignTransform(this->scene, i, position, this->scene->position[i]);
+    }
+}
+
+
+static void assignTransform(Scene* scene, int index, vec3 value, vec3 dest)
+{
+    // Only invalidate the cached world matrix on an actual change
+    if (! memcmp(value, dest, sizeof(vec3)))
+        return;
+
+    glm_vec3_copy(value, dest);
+    scene->dirty[index] = true;
+}
+
+
+static void addTransform(Scene* scene, int index, vec3 delta, vec3 dest)
+{
+    if (delta[X_COORD] == 0.0f && delta[Y_COORD] == 0.0f &&
+        delta[Z_COORD] == 0.0f)
+        return;
 
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->transformPosition((Box*)(iter->value), transform);
+    glm_vec3_add(delta, dest, dest);
+    scene->dirty[index] = true;
 }
 
 
 static void draw(Box* this, void* pointer)
 {
-    ListNode* iter;
-    Box* box;
-    int i = 0;
+    int size = this->scene->subtreeSize[this->index];
 
-    mat4 model;
+    if (! this->renderer)
+        return;
 
-    glBindVertexArray(this->VAO);
+    // World matrices and bounds for the whole model in one pass
+    this->scene->computeWorld(this->scene, this->index, size);
 
-    // Build up box's shader, textures and model matrix
-    this->setupShader(this);
-    this->setupTexture(this);
-    this->setupModelMatrix(this, model, pointer);
+    // Skip the whole model when none of it is in view
+    if (! this->renderer->isVisible(this->renderer,
+                                    this->scene->subtreeBounds[this->index],
+                                    size))
+        return;
 
-    // Draw
-    this->shader->setMat4(this->shader, "model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    drawParts(this, 0, 0, pointer);
+}
 
-    // Draw each attached box to this box
-    LIST_FOR_EACH(this->attached, iter)
-    {
-        box = (Box*)(iter->value);
-        box->setShader(box, this->shader);
-        box->draw(box, pointer);
-    }
 
-    i = 0;
-    LIST_FOR_EACH(this->textures, iter)
+// Instance matrices may only rotate, translate and scale uniformly, the
+// vertex shader reuses them for normals as they are
+static void drawInstanced(Box* this, mat4* instances, int count, void* pointer)
+{
+    vec3 bounds[2];
+    int size = this->scene->subtreeSize[this->index];
+    int visible = 0;
+    int offset;
+
+    if (count <= 0 || ! this->renderer)
+        return;
+
+    this->scene->computeWorld(this->scene, this->index, size);
+
+    // Instances out of view are dropped, the rest are packed to the front
+    // of the caller's array
+    for (int i = 0; i < count; i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i++);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glm_aabb_transform(this->scene->subtreeBounds[this->index],
+                           instances[i], bounds);
+
+        if (this->renderer->isVisible(this->renderer, bounds, size))
+            glm_mat4_copy(instances[i], instances[visible++]);
     }
+
+    if (! visible)
+        return;
+
+    if ((offset = this->renderer->pushInstances(this->renderer, instances,
+                                                visible)) < 0)
+        return;
+
+    drawParts(this, offset, visible, pointer);
 }
 
 
-static void setupShader(Box* this)
+static void drawParts(Box* this, int offset, int instances, void* pointer)
 {
-    this->shader->use(this->shader);
-    this->shader->setVec3(this->shader, "material.ambient",
-                          this->material->ambient);
-    this->shader->setInt(this->shader, "material.diffuse",
-                         this->material->diffuse);
-    this->shader->setInt(this->shader, "material.specular",
-                         this->material->specular);
-    this->shader->setFloat(this->shader, "material.shininess",
-                           this->material->shininess);
+    Box* box;
+    int end = SCENE_END(this->scene, this->index);
+
+    // Draw this box and every box attached to it
+    for (int i = this->index; i < end; i++)
+    {
+        box = this->scene->boxes[i];
+        box->setShader(box, this->shader);
+        submit(box, offset, instances, pointer);
+    }
 }
 
 
-static void setupTexture(Box* this)
+static void submit(Box* this, int offset, int instances, void* pointer)
 {
     ListNode* iter;
-    int i = 0;
+    RenderItem item;
+
+    memset(&item, 0, sizeof(RenderItem));
+
+    // Build up box's draw state and model matrix, the renderer sorts and
+    // applies it on flush
+    item.shader = this->shader;
+    item.geometry = this->geometry;
+    item.material = this->material;
+    item.instanceOffset = offset;
+    item.instanceCount = instances;
+
+    // Matrix callbacks run whether or not the box is culled, some of them
+    // animate from one call to the next
+    this->setupModelMatrix(this, item.model, pointer);
+
+    // Instanced draws were already tested per instance
+    if (! instances &&
+        ! this->renderer->isVisible(this->renderer,
+                                    this->scene->bounds[this->index], 1))
+        return;
 
-    // Bind all textures in box
     LIST_FOR_EACH(this->textures, iter)
     {
-        glActiveTexture(GL_TEXTURE0 + i++);
-        glBindTexture(GL_TEXTURE_2D, ((Texture*)iter->value)->ID);
+        if (item.textureCount < MAX_ITEM_TEXTURES)
+        {
+            item.textures[item.textureCount] = ((Texture*)iter->value)->ID;
+            item.layers[item.textureCount++] = ((Texture*)iter->value)->layer;
+        }
     }
+
+    this->renderer->submit(this->renderer, &item);
 }
 
 
 static void setupModelMatrix(Box* this, mat4 model, void* pointer)
 {
-    // Apply transformations to the model
-    glm_mat4_identity(model);
+    // Computed by the scene when the model is drawn
+    glm_mat4_copy(this->scene->world[this->index], model);
+}
+
+
+static void destroy(Box* this)
+{
+    Scene* owner = this->scene;
+    int index = this->index;
 
-    // Move box relative to world
-    glm_translate(model, this->position);
+    // Attached boxes belong to this box, free them along with it
+    for (int i = SCENE_END(owner, index) - 1; i > index; i--)
+        release(owner->boxes[i]);
 
-    glm_rotate_x(model, glm_rad(this->rotation[X_COORD]), model);
-    glm_rotate_y(model, glm_rad(this->rotation[Y_COORD]), model);
-    glm_rotate_z(model, glm_rad(this->rotation[Z_COORD]), model);
+    release(this);
+    owner->remove(owner, index);
 
-    // Move box relative to model
-    glm_translate(model, this->modelPosition);
+    // The last box out takes its scene with it, and the next newBox makes a
+    // fresh one
+    if (! owner->count)
+    {
+        if (owner == scene)
+            scene = NULL;
 
-    // Scale model
-    glm_scale(model, this->scale);
+        owner->destroy(owner);
+        SAFE_FREE(owner);
+    }
 }
 
 
-static void destroy(Box* this)
+static void release(Box* this)
 {
-    ListNode* iter;
+    if (this->textures)
+        this->textures->deleteListShallow(&this->textures);
+
+    if (this->material)
+        this->material->deleteMaterial(&this->material);
+
+    if (this->geometry)
+        this->geometry->release(this->geometry);
 
-    LIST_FOR_EACH(this->attached, iter)
-        ((Box*)(iter->value))->destroy((Box*)(iter->value));
-    this->attached->deleteList(&this->attached);
-    this->textures->deleteListShallow(&this->textures);
+    poolRelease(&boxPool, this);
 }
@@ -4,9 +4,12 @@
 #include <cglm/vec3.h>
 #include <cglm/mat4.h>
 
+#include "geometry.h"
 #include "list.h"
 #include "texture.h"
 #include "material.h"
+#include "renderer.h"
+#include "scene.h"
 
 #include "shader.h"
 
@@ -14,33 +17,38 @@
 
 typedef struct Box
 {
-    unsigned int VAO;
-    unsigned int VBO;
-    unsigned int vertexAttribPointerIndex;
+    Geometry* geometry;
+
+    // Position in the scene, the transform pointers below point into the
+    // scene's arrays and are kept up to date by it
+    Scene* scene;
+    int index;
 
     Shader* shader;
+    Renderer* renderer;
     List* textures;
-    vec3 modelPosition;
-    vec3 position;
-    vec3 scale;
-    vec3 rotation;
+    float* modelPosition;
+    float* position;
+    float* scale;
+    float* rotation;
 
     Material* material;
 
-    vec3 initialPosition;
-    vec3 initialRotation;
-
-    List* attached;
+    float* initialPosition;
+    float* initialRotation;
 
     void (*attach)(struct Box*, struct Box*);
 
     void (*setShader)(struct Box*, Shader*);
+    void (*setRenderer)(struct Box*, Renderer*);
     void (*addTexture)(struct Box*, Texture*);
     void (*setModelPosition)(struct Box*, vec3);
     void (*setPosition)(struct Box*, vec3);
     void (*setScale)(struct Box*, vec3);
     void (*setRotation)(struct Box*, vec3);
     void (*setRotationDelta)(struct Box*, vec3);
+    void (*setMatrixCallback)(struct Box*,
+                              void (*)(struct Box*, mat4, void*));
 
     void (*recordInitialPosition)(struct Box*);
     void (*recordInitialRotation)(struct Box*);
@@ -51,12 +59,13 @@ typedef struct Box
     void (*transformPosition)(struct Box*, mat4);
 
     void (*draw)(struct Box*, void*);
-    void (*setupShader)(struct Box*);
-    void (*setupTexture)(struct Box*);
+    void (*drawInstanced)(struct Box*, mat4*, int, void*);
     void (*setupModelMatrix)(struct Box*, mat4, void*);
     void (*destroy)(struct Box*);
 } Box;
 
 Box* newBox(vec3);
+Scene* getBoxScene(void);
+void deleteBoxes(void);
 
 #endif
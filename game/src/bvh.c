@@ -0,0 +1,488 @@
+#include <cglm/vec3.h>
+#include <cglm/vec4.h>
+#include <cglm/box.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "macros.h"
+
+#include "bvh.h"
+
+
+// Bounds and box count gathered for one split candidate
+typedef struct BvhBin
+{
+    vec3 bounds[2];
+    int count;
+} BvhBin;
+
+
+static void linkMethods(Bvh*);
+
+static bool build(Bvh*, vec3 (*)[2], int*, int);
+static void refit(Bvh*, vec3 (*)[2]);
+static int raycast(Bvh*, vec3, vec3, float, float*);
+static void resetStats(Bvh*);
+static void destroy(Bvh*);
+
+static bool split(Bvh*, int, vec3*);
+static void fitNode(Bvh*, int);
+static bool hitNode(Bvh*, BvhNode*, vec3, vec3, float, float*);
+static bool hitBox(Bvh*, vec3*, vec3, vec3, float, float*);
+static bool slab(vec3, vec3, vec3, vec3, float, float*);
+static float area(vec3, vec3);
+static void emptyBounds(vec3*);
+
+
+Bvh* newBvh()
+{
+    Bvh* bvh;
+
+    if (! (bvh = (Bvh*)malloc(sizeof(Bvh))))
+    {
+        fprintf(stderr, ERR_BVH_MALLOC);
+        return NULL;
+    }
+
+    memset(bvh, 0, sizeof(Bvh));
+    linkMethods(bvh);
+
+#if defined(__SSE__)
+    bvh->simd = true;
+#endif
+
+    return bvh;
+}
+
+
+static void linkMethods(Bvh* this)
+{
+    this->build = build;
+    this->refit = refit;
+    this->raycast = raycast;
+    this->resetStats = resetStats;
+    this->destroy = destroy;
+}
+
+
+static bool build(Bvh* this, vec3 (*bounds)[2], int* items, int count)
+{
+    vec3* centroids;
+    int* stack;
+    int* depth;
+    int top = 0;
+    int node;
+    int level;
+
+    destroy(this);
+
+    if (count <= 0)
+        return true;
+
+    this->bounds = bounds;
+    this->itemCount = count;
+
+    // A binary tree over count leaves never needs more than 2 * count - 1
+    this->nodes = (BvhNode*)malloc((2 * count - 1) * sizeof(BvhNode));
+    this->items = (int*)malloc(count * sizeof(int));
+    centroids = (vec3*)malloc(count * sizeof(vec3));
+    stack = (int*)malloc(2 * count * sizeof(int));
+    depth = (int*)malloc(2 * count * sizeof(int));
+
+    if (! this->nodes || ! this->items || ! centroids || ! stack || ! depth)
+    {
+        fprintf(stderr, ERR_BVH_MALLOC);
+        SAFE_FREE(centroids);
+        SAFE_FREE(stack);
+        SAFE_FREE(depth);
+        destroy(this);
+        return false;
+    }
+
+    memcpy(this->items, items, count * sizeof(int));
+
+    // Indexed by position in items, and shuffled along with them
+    for (int i = 0; i < count; i++)
+        glm_aabb_center(bounds[items[i]], centroids[i]);
+
+    this->nodes[0].first = 0;
+    this->nodes[0].count = count;
+    this->nodeCount = 1;
+
+    stack[top] = 0;
+    depth[top++] = 0;
+
+    while (top)
+    {
+        node = stack[--top];
+        level = depth[top];
+        fitNode(this, node);
+
+        // Past BVH_DEPTH whatever is left stays one leaf, so a ray's stack
+        // can never overflow
+        if (level >= BVH_DEPTH || ! split(this, node, centroids))
+            continue;
+
+        for (int i = 1; i >= 0; i--)
+        {
+            stack[top] = this->nodes[node].first + i;
+            depth[top++] = level + 1;
+        }
+    }
+
+    SAFE_FREE(centroids);
+    SAFE_FREE(stack);
+    SAFE_FREE(depth);
+
+    return true;
+}
+
+
+static void refit(Bvh* this, vec3 (*bounds)[2])
+{
+    this->bounds = bounds;
+
+    // Children always come after their parent, so walking backwards has
+    // every child ready before the node above it
+    for (int i = this->nodeCount - 1; i >= 0; i--)
+        fitNode(this, i);
+}
+
+
+static int raycast(Bvh* this, vec3 origin, vec3 direction, float reach,
+                   float* distance)
+{
+    int stack[BVH_DEPTH + 2];
+    int top = 0;
+    int nearest = BVH_MISS;
+    float best = reach;
+    float near[2];
+    bool hits[2];
+    float t;
+    vec3 inverse;
+
+    BvhNode* node;
+    BvhNode* children;
+
+    if (! this->nodeCount)
+        return BVH_MISS;
+
+    this->stats.rays++;
+
+    // Zero components turn into infinities, which the slab test handles
+    for (int i = 0; i < 3; i++)
+        inverse[i] = 1.0f / direction[i];
+
+    if (hitNode(this, this->nodes, origin, inverse, best, &t))
+        stack[top++] = 0;
+
+    while (top)
+    {
+        node = this->nodes + stack[--top];
+        this->stats.nodes++;
+
+        if (node->count)
+        {
+            for (int i = node->first; i < node->first + node->count; i++)
+                if (hitBox(this, this->bounds[this->items[i]], origin,
+                           inverse, best, &t))
+                {
+                    best = t;
+                    nearest = this->items[i];
+                }
+
+            continue;
+        }
+
+        children = this->nodes + node->first;
+
+        hits[0] = hitNode(this, children, origin, inverse, best, near);
+        hits[1] = hitNode(this, children + 1, origin, inverse, best, near + 1);
+
+        // The nearer child goes on top, its hits shorten the far one's ray
+        if (hits[0] && hits[1])
+        {
+            stack[top++] = node->first + (near[0] <= near[1]);
+            stack[top++] = node->first + (near[0] > near[1]);
+        }
+        else if (hits[0])
+            stack[top++] = node->first;
+        else if (hits[1])
+            stack[top++] = node->first + 1;
+    }
+
+    if (distance && nearest != BVH_MISS)
+        *distance = best;
+
+    return nearest;
+}
+
+
+static void resetStats(Bvh* this)
+{
+    memset(&(this->stats), 0, sizeof(BvhStats));
+}
+
+
+static void destroy(Bvh* this)
+{
+    SAFE_FREE(this->nodes);
+    SAFE_FREE(this->items);
+    this->nodeCount = 0;
+    this->itemCount = 0;
+}
+
+
+static bool split(Bvh* this, int index, vec3* centroids)
+{
+    BvhNode* node = this->nodes + index;
+    BvhBin bins[BVH_BINS];
+    vec3 centre[2];
+    vec3 left[2];
+    vec3 right[2];
+    float leftArea[BVH_BINS];
+    int leftCount[BVH_BINS];
+    float bestCost;
+    int bestAxis = -1;
+    int bestSplit = 0;
+    int first = node->first;
+    int count = node->count;
+    int rightCount;
+    int middle;
+    int item;
+    int bin;
+    float cost;
+    float scale;
+    vec3 temp;
+
+    if (count <= BVH_LEAF_SIZE)
+        return false;
+
+    // Splitting has to beat testing every box in the node
+    bestCost = count * area(node->min, node->max);
+
+    emptyBounds(centre);
+    for (int i = first; i < first + count; i++)
+    {
+        glm_vec3_minv(centre[0], centroids[i], centre[0]);
+        glm_vec3_maxv(centre[1], centroids[i], centre[1]);
+    }
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (centre[1][axis] <= centre[0][axis])
+            continue;
+
+        scale = BVH_BINS / (centre[1][axis] - centre[0][axis]);
+
+        for (int b = 0; b < BVH_BINS; b++)
+        {
+            emptyBounds(bins[b].bounds);
+            bins[b].count = 0;
+        }
+
+        for (int i = first; i < first + count; i++)
+        {
+            bin = MIN((int)((centroids[i][axis] - centre[0][axis]) * scale),
+                      BVH_BINS - 1);
+            bins[bin].count++;
+            glm_aabb_merge(bins[bin].bounds, this->bounds[this->items[i]],
+                           bins[bin].bounds);
+        }
+
+        // Sweep from the left keeping every prefix, then from the right
+        // scoring each split between bins against it
+        emptyBounds(left);
+        for (int b = 0, n = 0; b < BVH_BINS - 1; b++)
+        {
+            n += bins[b].count;
+            glm_aabb_merge(left, bins[b].bounds, left);
+            leftCount[b] = n;
+            leftArea[b] = area(left[0], left[1]);
+        }
+
+        emptyBounds(right);
+        rightCount = 0;
+
+        for (int b = BVH_BINS - 1; b > 0; b--)
+        {
+            rightCount += bins[b].count;
+            glm_aabb_merge(right, bins[b].bounds, right);
+
+            if (! leftCount[b - 1] || ! rightCount)
+                continue;
+
+            cost = leftCount[b - 1] * leftArea[b - 1] +
+                   rightCount * area(right[0], right[1]);
+
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+        return false;
+
+    // Partition items and their centroids in place about the chosen bin
+    scale = BVH_BINS / (centre[1][bestAxis] - centre[0][bestAxis]);
+    middle = first;
+
+    for (int i = first; i < first + count; i++)
+    {
+        bin = MIN((int)((centroids[i][bestAxis] - centre[0][bestAxis]) * scale),
+                  BVH_BINS - 1);
+
+        if (bin >= bestSplit)
+            continue;
+
+        item = this->items[i];
+        this->items[i] = this->items[middle];
+        this->items[middle] = item;
+
+        glm_vec3_copy(centroids[i], temp);
+        glm_vec3_copy(centroids[middle], centroids[i]);
+        glm_vec3_copy(temp, centroids[middle]);
+        middle++;
+    }
+
+    this->nodes[this->nodeCount].first = first;
+    this->nodes[this->nodeCount].count = middle - first;
+    this->nodes[this->nodeCount + 1].first = middle;
+    this->nodes[this->nodeCount + 1].count = first + count - middle;
+
+    node->first = this->nodeCount;
+    node->count = 0;
+    this->nodeCount += 2;
+
+    return true;
+}
+
+
+static void fitNode(Bvh* this, int index)
+{
+    BvhNode* node = this->nodes + index;
+    vec3 bounds[2];
+
+    emptyBounds(bounds);
+
+    if (node->count)
+        for (int i = node->first; i < node->first + node->count; i++)
+            glm_aabb_merge(bounds, this->bounds[this->items[i]], bounds);
+    else
+        for (int i = 0; i < 2; i++)
+        {
+            glm_vec3_minv(bounds[0], this->nodes[node->first + i].min, bounds[0]);
+            glm_vec3_maxv(bounds[1], this->nodes[node->first + i].max, bounds[1]);
+        }
+
+    glm_vec4(bounds[0], -INFINITY, node->min);
+    glm_vec4(bounds[1], INFINITY, node->max);
+}
+
+
+static bool hitNode(Bvh* this, BvhNode* node, vec3 origin, vec3 inverse,
+                    float reach, float* near)
+{
+#if defined(__SSE__)
+    __m128 o;
+    __m128 d;
+    __m128 lo;
+    __m128 hi;
+
+    if (this->simd)
+    {
+        // The fourth lane spans -inf to inf, so it never narrows the range
+        o = _mm_setr_ps(origin[0], origin[1], origin[2], 0.0f);
+        d = _mm_setr_ps(inverse[0], inverse[1], inverse[2], 1.0f);
+
+        lo = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->min), o), d);
+        hi = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->max), o), d);
+
+        d = _mm_min_ps(lo, hi);
+        hi = _mm_max_ps(lo, hi);
+        lo = d;
+
+        lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 0, 3, 2)));
+        hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 0, 3, 2)));
+
+        lo = _mm_max_ss(lo, _mm_setzero_ps());
+        hi = _mm_min_ss(hi, _mm_set_ss(reach));
+
+        *near = _mm_cvtss_f32(lo);
+        return _mm_comile_ss(lo, hi);
+    }
+#endif
+
+    return slab(node->min, node->max, origin, inverse, reach, near);
+}
+
+
+static bool hitBox(Bvh* this, vec3* bounds, vec3 origin, vec3 inverse,
+                   float reach, float* near)
+{
+    BvhNode box;
+
+    this->stats.tested++;
+
+    if (! this->simd)
+        return slab(bounds[0], bounds[1], origin, inverse, reach, near);
+
+    glm_vec4(bounds[0], -INFINITY, box.min);
+    glm_vec4(bounds[1], INFINITY, box.max);
+
+    return hitNode(this, &box, origin, inverse, reach, near);
+}
+
+
+static bool slab(vec3 min, vec3 max, vec3 origin, vec3 inverse, float reach,
+                 float* near)
+{
+    float lo = 0.0f;
+    float hi = reach;
+    float t1;
+    float t2;
+
+    for (int i = 0; i < 3; i++)
+    {
+        t1 = (min[i] - origin[i]) * inverse[i];
+        t2 = (max[i] - origin[i]) * inverse[i];
+
+        lo = MAX(lo, MIN(t1, t2));
+        hi = MIN(hi, MAX(t1, t2));
+    }
+
+    *near = lo;
+    return lo <= hi;
+}
+
+
+static float area(vec3 min, vec3 max)
+{
+    vec3 extent;
+
+    glm_vec3_sub(max, min, extent);
+
+    return extent[0] * extent[1] + extent[1] * extent[2] +
+           extent[2] * extent[0];
+}
+
+
+static void emptyBounds(vec3* bounds)
+{
+    glm_vec3_fill(bounds[0], INFINITY);
+    glm_vec3_fill(bounds[1], -INFINITY);
+}
@@ -0,0 +1,74 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cglm/vec3.h>
+#include <cglm/vec4.h>
+
+#include <stdbool.h>
+
+#define ERR_BVH_MALLOC "Error: unable to allocate memory for bounding volume hierarchy\n"
+
+// Split candidates tried along each axis when building
+#define BVH_BINS 12
+
+// Nodes with this many boxes or fewer are never split
+#define BVH_LEAF_SIZE 2
+
+// Deepest a tree is built, nodes below are left as bigger leaves
+#define BVH_DEPTH 48
+
+#define BVH_MISS -1
+
+
+typedef struct BvhStats
+{
+    unsigned int rays;
+    unsigned int nodes;
+    unsigned int tested;
+} BvhStats;
+
+
+// The fourth component of min and max is -inf and inf, so a four wide slab
+// test can run straight off the node
+typedef struct BvhNode
+{
+    vec4 min;
+    vec4 max;
+
+    // Leaves list count items from first, inner nodes have count 0 and their
+    // children at first and first + 1
+    int first;
+    int count;
+} BvhNode;
+
+
+// Bounding volume hierarchy over world space boxes, split by the surface
+// area heuristic. Items are indices into a bounds array the caller owns,
+// refit re-reads it after things move without changing the tree's shape
+typedef struct Bvh
+{
+    BvhNode* nodes;
+    int nodeCount;
+
+    // Set by build and refit, read by every raycast
+    vec3 (*bounds)[2];
+
+    int* items;
+    int itemCount;
+
+    // Ray against box tests four lanes at a time where SSE is available
+    bool simd;
+
+    BvhStats stats;
+
+    bool (*build)(struct Bvh*, vec3 (*)[2], int*, int);
+    void (*refit)(struct Bvh*, vec3 (*)[2]);
+    int (*raycast)(struct Bvh*, vec3, vec3, float, float*);
+    void (*resetStats)(struct Bvh*);
+    void (*destroy)(struct Bvh*);
+} Bvh;
+
+
+Bvh* newBvh(void);
+
+#endif
@@ -8,8 +8,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "box.h"
-#include "list.h"
 #include "macros.h"
 
 #include "camera.h"
@@ -26,9 +24,6 @@ static void moveRight(Camera*, float);
 static void moveMouse(Camera*, double, double, bool);
 static void scrollMouse(Camera*, float);
 
-static void attach(Camera*, Box*);
-static void detach(Camera*);
-
 static void setPosition(Camera*, vec3);
 static void setFront(Camera*, vec3);
 static void setJump(Camera*, bool);
@@ -37,11 +32,11 @@ static void recordInitialPosition(Camera*);
 static void resetPosition(Camera*);
 static void resetFront(Camera*);
 
-static void poll(Camera*);
+static void poll(Camera*, float);
 static void destroy(Camera*);
 
 static void updateCameraVectors(Camera*);
-static void jump(Camera*);
+static void jump(Camera*, float);
 
 static float calcJump(float t);
 static float _calcJump(float t);
@@ -73,8 +68,6 @@ Camera* newCamera(vec3 position)
     cam->mouseSensitivity = 0.05f;
     cam->zoom = 45.0f;
 
-    cam->attached = newList();
-
     cam->recordInitialPosition(cam);
     updateCameraVectors(cam);
 
@@ -93,9 +86,6 @@ static void linkMethods(Camera* this)
     this->moveMouse = moveMouse;
     this->scrollMouse = scrollMouse;
 
-    this->attach = attach;
-    this->detach = detach;
-
     this->setPosition = setPosition;
     this->setFront = setFront;
     this->setJump = setJump;
@@ -119,9 +109,6 @@ static void getViewMatrix(Camera* this, mat4 result)
 
 static void moveForward(Camera* this, float timeDelta)
 {
-    ListNode* node;
-    Box* attach;
-
     vec3 temp;
 
     // Suppress y component of the camera front
@@ -129,39 +116,19 @@ static void moveForward(Camera* this, float timeDelta)
     glm_vec3_normalize(temp);
     glm_vec3_scale(temp, this->speed * timeDelta, temp);
     glm_vec3_add(temp, this->position, this->position);
-
-    LIST_FOR_EACH(this->attached, node)
-    {
-        attach = (Box*)(node->value);
-        attach->move(attach, temp);
-    }
 }
 
 
 static void moveLeft(Camera* this, float timeDelta)
 {
-    ListNode* node;
-    Box* attach;
-
     vec3 temp;
     glm_vec3_scale(this->right, this->speed * timeDelta, temp);
     glm_vec3_sub(this->position, temp, this->position);
-
-    glm_vec3_negate(temp);
-
-    LIST_FOR_EACH(this->attached, node)
-    {
-        attach = (Box*)(node->value);
-        attach->move(attach, temp);
-    }
 }
 
 
 static void moveBackward(Camera* this, float timeDelta)
 {
-    ListNode* node;
-    Box* attach;
-
     vec3 temp;
 
     // Suppress y component of the camera front
@@ -169,43 +136,20 @@ static void moveBackward(Camera* this, float timeDelta)
     glm_vec3_normalize(temp);
     glm_vec3_scale(temp, this->speed * timeDelta, temp);
     glm_vec3_sub(this->position, temp, this->position);
-
-    glm_vec3_negate(temp);
-
-    LIST_FOR_EACH(this->attached, node)
-    {
-        attach = (Box*)(node->value);
-        attach->move(attach, temp);
-    }
 }
 
 
 static void moveRight(Camera* this, float timeDelta)
 {
-    ListNode* node;
-    Box* attach;
-
     vec3 temp;
     glm_vec3_scale(this->right, this->speed * timeDelta, temp);
     glm_vec3_add(this->position, temp, this->position);
-
-    LIST_FOR_EACH(this->attached, node)
-    {
-        attach = (Box*)(node->value);
-        attach->move(attach, temp);
-    }
 }
 
 
 static void moveMouse(Camera* this, double xoffset,
                       double yoffset, bool constraint)
 {
-    ListNode* node;
-    Box* attach;
-
-    vec3 tempPos;
-    vec3 temp;
-
     // Update yaw and pitch by mouse sensitivity
     this->yaw += xoffset * this->mouseSensitivity;
     this->pitch += yoffset * this->mouseSensitivity;
@@ -213,19 +157,6 @@ static void moveMouse(Camera* this, double xoffset,
     this->pitch = constraint && this->pitch < -89.0f ? -89.0f : this->pitch;
 
     updateCameraVectors(this);
-
-    glm_vec3_copy(this->front, temp);
-    glm_vec3_normalize_to((vec3){temp[X_COORD], 0.0f, temp[Z_COORD]}, temp);
-    LIST_FOR_EACH(this->attached, node)
-    {
-        attach = (Box*)(node->value);
-        glm_vec3_copy((vec3){this->position[X_COORD],
-                             attach->position[Y_COORD],
-                             this->position[Z_COORD]}, tempPos);
-        glm_vec3_add(temp, tempPos, temp);
-        attach->setPosition(attach, temp);
-        attach->setRotation(attach, (vec3){0.0f, -(this->yaw - 90.0f), 0.0f});
-    }
 }
 
 
@@ -237,20 +168,6 @@ static void scrollMouse(Camera* this, float yoffset)
 }
 
 
-static void attach(Camera* this, Box* box)
-{
-    this->attached->insertLast(this->attached, box, true);
-}
-
-
-static void detach(Camera* this)
-{
-    // Drop everything
-    this->attached->deleteListShallow(&(this->attached));
-    this->attached = newList();
-}
-
-
 static void setPosition(Camera* this, vec3 newPos)
 {
     glm_vec3_copy(newPos, this->position);
@@ -277,17 +194,7 @@ static void recordInitialPosition(Camera* this)
 
 static void resetPosition(Camera* this)
 {
-    ListNode* node;
-    Box* attach;
-
     this->setPosition(this, this->initialPosition);
-
-    LIST_FOR_EACH(this->attached, node)
-    {
-        attach = (Box*)(node->value);
-        attach->resetPosition(attach);
-        attach->resetRotation(attach);
-    }
 }
 
 
@@ -300,15 +207,14 @@ static void resetFront(Camera* this)
 }
 
 
-static void poll(Camera* this)
+static void poll(Camera* this, float step)
 {
-    jump(this);
+    jump(this, step);
 }
 
 
 static void destroy(Camera* this)
 {
-    this->attached->deleteListShallow(&this->attached);
 }
 
 
@@ -324,17 +230,17 @@ static void updateCameraVectors(Camera* this)
 }
 
 
-static void jump(Camera* this)
+static void jump(Camera* this, float step)
 {
     static bool start = true;
-    static float startTime = 0.0f;
+    static float elapsed = 0.0f;
     static float initialPosition = 0.0f;
 
     // Set variables if activated
     if (! this->jumping)
     {
         start = true;
-        startTime = 0.0f;
+        elapsed = 0.0f;
         initialPosition = 0.0f;
         this->position[Y_COORD] = initialPosition;
         this->setJump(this, false);
@@ -346,20 +252,21 @@ static void jump(Camera* this)
     if (start)
     {
         start = false;
-        startTime = glfwGetTime();
+        elapsed = 0.0f;
         initialPosition = this->position[Y_COORD];
 
         return;
     }
 
-    // Set y position along curve as time increases
-    this->position[Y_COORD] = initialPosition + calcJump(glfwGetTime() - startTime);
+    // Set y position along curve as simulated time increases
+    elapsed += step;
+    this->position[Y_COORD] = initialPosition + calcJump(elapsed);
 
     // Check jump finish
     if ((this->position[Y_COORD] - initialPosition) < 0.0f)
     {
         start = true;
-        startTime = 0.0f;
+        elapsed = 0.0f;
         initialPosition = 0.0f;
         this->position[Y_COORD] = initialPosition;
         this->setJump(this, false);
@@ -2,11 +2,10 @@
 #define CAMERA_H
 
 #include <GLFW/glfw3.h>
+#include <stdbool.h>
 #include <cglm/vec3.h>
 #include <cglm/mat4.h>
 
-#include "box.h"
-#include "list.h"
 
 #define ERR_CAMERA_MALLOC "Error: unable to allocate memory for camera\n"
 
@@ -30,8 +29,6 @@ typedef struct Camera
     float mouseSensitivity;
     float zoom;
 
-    List* attached;
-
     bool jumping;
 
     void (*getViewMatrix)(struct Camera*, mat4);
@@ -43,9 +40,6 @@ typedef struct Camera
     void (*moveMouse)(struct Camera*, double, double, bool);
     void (*scrollMouse)(struct Camera*, float);
 
-    void (*attach)(struct Camera*, Box*);
-    void (*detach)(struct Camera*);
-
     void (*recordInitialPosition)(struct Camera*);
     void (*resetPosition)(struct Camera*);
     void (*resetFront)(struct Camera*);
@@ -54,7 +48,7 @@ typedef struct Camera
     void (*setFront)(struct Camera*, vec3);
     void (*setJump)(struct Camera*, bool);
 
-    void (*poll)(struct Camera*);
+    void (*poll)(struct Camera*, float);
     void (*destroy)(struct Camera*);
 } Camera;
 
@@ -6,35 +6,156 @@
 #include <cglm/vec3.h>
 #include <cglm/io.h>
 
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+#include "bench.h"
 #include "box.h"
+#include "bvh.h"
 #include "camera.h"
+#include "grid.h"
 #include "hashtable.h"
 #include "list.h"
+#include "loader.h"
 #include "log.h"
 #include "macros.h"
 #include "models.h"
+#include "pack.h"
+#include "pacer.h"
+#include "renderer.h"
+#include "scene.h"
 #include "shader.h"
 #include "texture.h"
+#include "timer.h"
+#include "uniforms.h"
 
 #include "game.h"
 
 
-int main(void)
+// Names of every handle, in enum order
+static const char* shaderNames[SHADER_COUNT] = {"shader"};
+
+// Injected after #version, in LightingVariant order
+static const char* lightingDefines[LIGHTING_COUNT] = {
+    "#define LIGHT_AMBIENT vec3(1.0)\n"
+    "#define LIGHT_DIFFUSE vec3(1.0)\n"
+    "#define LIGHT_SPECULAR vec3(1.0)\n",
+
+    "#define SPOTLIGHT\n"
+    "#define LIGHT_AMBIENT vec3(0.2)\n"
+    "#define LIGHT_DIFFUSE vec3(0.5)\n"
+    "#define LIGHT_SPECULAR vec3(1.0)\n",
+
+    "#define SPOTLIGHT\n"
+    "#define LIGHT_AMBIENT vec3(0.1)\n"
+    "#define LIGHT_SPECULAR vec3(0.1)\n"
+};
+
+static const char* textureNames[TEXTURE_COUNT] = {
+    "black", "game_over", "game_win", "grass",
+    "grey", "red", "safe_zone", "sheep_face",
+    "sheep_skin", "sign_1", "sign_2", "table",
+    "tree_1", "tree_2", "white", "wolf_face"
+};
+
+static const char* modelNames[MODEL_COUNT] = {
+    "ground", "tree", "wolf", "sheep", "table", "torch",
+    "sign", "trap", "safe_zone", "game_over", "game_win"
+};
+
+// Scenery that stays put after init, everything else is dynamic and drawn box
+// by box
+static const ModelHandle staticModels[] = {
+    MODEL_GROUND, MODEL_TABLE, MODEL_SIGN, MODEL_SAFE_ZONE
+};
+
+// Models rays can hit. Trees and traps are drawn from one box moved around,
+// so they have no place of their own to be picked at
+static const ModelHandle pickModels[] = {
+    MODEL_GROUND, MODEL_WOLF, MODEL_SHEEP, MODEL_TABLE, MODEL_TORCH,
+    MODEL_SIGN, MODEL_SAFE_ZONE
+};
+
+
+int main(int argc, char** argv)
 {
-    Backend* engine = init();
-    loop(engine);
+    Bench* bench = NULL;
+    Backend* engine;
+    double rate = SIM_RATE;
+    PaceMode pacing = PACE_VSYNC;
+    double fps = PACE_FPS;
+    int status = 0;
+
+    // Benchmark mode renders offscreen and writes a report instead of
+    // opening a window
+    if (argc > 1 && ! strcmp(argv[1], BENCH_FLAG) &&
+        ! (bench = newBench(argc - 2, argv + 2)))
+        return 1;
+
+    // Windowed runs take the simulation and pacing flags in any order
+    for (int i = 1; ! bench && i + 1 < argc; i += 2)
+    {
+        if (! strcmp(argv[i], SIM_RATE_FLAG))
+            rate = MAX(atof(argv[i + 1]), 1.0);
+        else if (! strcmp(argv[i], PACE_FLAG))
+            pacing = findPaceMode(argv[i + 1]);
+        else if (! strcmp(argv[i], PACE_FPS_FLAG))
+            fps = atof(argv[i + 1]);
+    }
+
+    if (pacing == PACE_MODE_COUNT || fps <= 0.0)
+    {
+        fprintf(stderr, ERR_PACER_ARGS);
+        return 1;
+    }
+
+    engine = init(bench);
+
+    if (engine)
+        engine->simStep = 1.0 / rate;
+
+    if (engine && ! bench)
+        engine->pacer = newPacer(engine->window, pacing, fps);
+
+    // A window or context that never came up, a failed check or an unwritten
+    // report all end the run with an error
+    if (! engine || ! engine->renderer)
+        status = 1;
+    else if (bench)
+        status = bench->run(bench, engine) ? 0 : 1;
+    else
+        loop(engine);
+
     terminate(&engine);
-    return 0;
+
+    if (bench)
+    {
+        bench->destroy(bench);
+        SAFE_FREE(bench);
+    }
+
+    return status;
 }
 
 
-Backend* init()
+Backend* init(Bench* bench)
 {
     Backend* engine;
+    Loader* loader = NULL;
+    Pack* pack;
+    bool ready;
+
+    double start = getWallTime();
+    double context;
+    double textures;
+    double shaders;
+    double finished;
+    int cached = 0;
+    int programs = 0;
 
     if (! (engine = (Backend*)malloc(sizeof(Backend))))
     {
@@ -55,19 +176,79 @@ Backend* init()
         return NULL;
     }
 
-    initWindow(engine);
-    initGlad(engine);
+    // A prebuilt pack has everything ready to upload. Without one, textures
+    // are read and decoded in the background while the window and GL come up
+    if (! (pack = newPack(ASSET_PACK)))
+        loader = startTextureLoader();
 
-    if (engine->window)
+    if (bench)
+        ready = bench->initContext(bench, engine);
+    else
+    {
+        initWindow(engine);
+        initGlad(engine);
+        ready = engine->window != NULL;
+    }
+
+    context = getWallTime();
+
+    if (ready)
     {
         glEnable(GL_DEPTH_TEST);
-        initShader(engine);
-        initTextures(engine);
+        engine->renderer = newRenderer();
+        // Shaders compile while the textures upload and the models are
+        // built, and are only waited on after that
+        shaders = getWallTime();
+        initShader(engine, pack);
+        shaders = getWallTime() - shaders;
+
+        textures = getWallTime();
+        initTextures(engine, pack, loader);
+        textures = getWallTime() - textures;
+
         initShapes(engine);
+
+        finished = getWallTime();
+        finishShaders(engine, &cached, &programs);
+        finished = getWallTime() - finished;
+
+        fprintf(stderr, LOG_STARTUP_SHADERS, shaders * 1000.0,
+                finished * 1000.0, cached, programs,
+                parallelShaderCompile() ? "on" : "off");
+
+        if (pack)
+            fprintf(stderr, LOG_STARTUP_PACK,
+                    (getWallTime() - start) * 1000.0,
+                    (context - start) * 1000.0, textures * 1000.0,
+                    pack->filename);
+        else if (loader)
+            fprintf(stderr, LOG_STARTUP,
+                    (getWallTime() - start) * 1000.0,
+                    (context - start) * 1000.0, textures * 1000.0,
+                    loader->stats.decodeTime * 1000.0, loader->threadCount,
+                    loader->stats.waitTime * 1000.0);
+    }
+
+    if (loader)
+    {
+        loader->destroy(loader);
+        SAFE_FREE(loader);
     }
 
-    glfwSetWindowUserPointer(engine->window, engine);
+    // GL holds its own copies of everything by now
+    if (pack)
+    {
+        pack->destroy(pack);
+        SAFE_FREE(pack);
+    }
+
+    if (engine->window)
+        glfwSetWindowUserPointer(engine->window, engine);
+
     resetGameSettings(engine);
+    initWorld(engine);
+    initColliders(engine);
+    initPicking(engine);
 
     return engine;
 }
@@ -110,54 +291,98 @@ void initGlad(Backend* engine)
 }
 
 
-void initShader(Backend* engine)
+void initShader(Backend* engine, Pack* pack)
 {
     HashTable* shaders = newHashTable();
-    char* filenames[] = {"shader"};
 
-    for (int i = 0; i < sizeof(filenames) / sizeof(filenames[0]); i++)
+    for (int i = 0; i < SHADER_COUNT; i++)
     {
         char vertexFilename[BUFSIZ];
         char fragmentFilename[BUFSIZ];
 
-        snprintf(vertexFilename, BUFSIZ, "shaders/%s.vs", filenames[i]);
-        snprintf(fragmentFilename, BUFSIZ, "shaders/%s.fs", filenames[i]);
+        snprintf(vertexFilename, BUFSIZ, "shaders/%s.vs", shaderNames[i]);
+        snprintf(fragmentFilename, BUFSIZ, "shaders/%s.fs", shaderNames[i]);
 
         shaders->insert(
             shaders,
-            filenames[i],
-            newShader(vertexFilename, fragmentFilename),
+            shaderNames[i],
+            newShader(pack, vertexFilename, fragmentFilename,
+                      lightingDefines, LIGHTING_COUNT),
             true
         );
     }
 
     engine->shaders = shaders;
+    resolveHandles(shaders, shaderNames, (void**)engine->shaderHandles,
+                   SHADER_COUNT);
+}
+
+
+void finishShaders(Backend* engine, int* cached, int* programs)
+{
+    Shader* shader;
+
+    for (int i = 0; i < SHADER_COUNT; i++)
+    {
+        if (! (shader = engine->shaderHandles[i]))
+            continue;
+
+        shader->finish(shader);
+
+        for (int j = 0; j < shader->variantCount; j++)
+            *cached += shader->programs[j].cached;
+
+        *programs += shader->variantCount;
+    }
+}
+
+
+Loader* startTextureLoader()
+{
+    char paths[TEXTURE_COUNT][BUFSIZ];
+    char* filenames[TEXTURE_COUNT];
+
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+    {
+        snprintf(paths[i], BUFSIZ, TEXTURE_PATH, textureNames[i]);
+        filenames[i] = paths[i];
+    }
+
+    return newLoader(filenames, TEXTURE_COUNT, 4, false);
 }
 
 
-void initTextures(Backend* engine)
+void initTextures(Backend* engine, Pack* pack, Loader* loader)
 {
     HashTable* textures = newHashTable();
-    char* filenames[] = {
-        "black", "game_over", "game_win", "grass",
-        "grey", "red", "safe_zone", "sheep_face",
-        "sheep_skin", "sign_1", "sign_2", "table",
-        "tree_1", "tree_2", "white", "wolf_face"
-    };
-
-    for (int i = 0; i < sizeof(filenames) / sizeof(filenames[0]); i++)
-    {
-        char filename[BUFSIZ];
-        snprintf(filename, BUFSIZ, "resources/%s.png", filenames[i]);
-        textures->insert(
-            textures,
-            filenames[i],
-            newTexture(filename, GL_RGBA, false),
-            true
-        );
+    Texture* packed[TEXTURE_COUNT];
+    char paths[TEXTURE_COUNT][BUFSIZ];
+    char* filenames[TEXTURE_COUNT];
+
+    memset(packed, 0, sizeof(packed));
+
+    // Same sized textures end up as layers of one array, so drawing the
+    // scene only binds a single texture
+    if (pack)
+    {
+        for (int i = 0; i < TEXTURE_COUNT; i++)
+        {
+            snprintf(paths[i], BUFSIZ, TEXTURE_PATH, textureNames[i]);
+            filenames[i] = paths[i];
+        }
+
+        packTexturesFromPack(packed, pack, filenames, TEXTURE_COUNT);
     }
+    else if (loader)
+        packTextures(packed, loader, GL_RGBA);
+
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+        if (packed[i])
+            textures->insert(textures, textureNames[i], packed[i], true);
 
     engine->textures = textures;
+    resolveHandles(textures, textureNames, (void**)engine->textureHandles,
+                   TEXTURE_COUNT);
 }
 
 
@@ -165,6 +390,9 @@ void initShapes(Backend* engine)
 {
     Material* defaultMaterial;
     Material* shinyMaterial;
+    HashEntry* iter;
+    Box* box;
+
     engine->models = newHashTable();
 
     // Default Material
@@ -194,14 +422,46 @@ void initShapes(Backend* engine)
     initGameMessage(engine, defaultMaterial, "game_over");
     initGameMessage(engine, defaultMaterial, "game_win");
 
-    SAFE_FREE(defaultMaterial);
-    SAFE_FREE(shinyMaterial);
+    // Every model submits its draws through the engine's render queue
+    HASHTABLE_FOR_EACH(engine->models, iter)
+    {
+        box = (Box*)iter->value;
+        box->setRenderer(box, engine->renderer);
+    }
+
+    resolveHandles(engine->models, modelNames, (void**)engine->modelHandles,
+                   MODEL_COUNT);
+
+    // Pre-transform the scenery into world space and merge it by texture
+    // and material
+    if ((engine->scenery = newBakedScene()))
+    {
+        for (int i = 0; i < sizeof(staticModels) / sizeof(staticModels[0]); i++)
+            if (engine->modelHandles[staticModels[i]])
+                engine->scenery->add(engine->scenery,
+                                     engine->modelHandles[staticModels[i]]);
+
+        engine->scenery->build(engine->scenery);
+    }
+
+    defaultMaterial->deleteMaterial(&defaultMaterial);
+    shinyMaterial->deleteMaterial(&shinyMaterial);
+}
+
+
+void resolveHandles(HashTable* table, const char** names, void** handles,
+                    int count)
+{
+    for (int i = 0; i < count; i++)
+        if (! (handles[i] = table->search(table, names[i])))
+            fprintf(stderr, ERR_HANDLE, names[i]);
 }
 
 
 void resetGameSettings(Backend* engine)
 {
     engine->options[GAME_USE_PERSPECTIVE] = true;
+    engine->options[GAME_USE_INSTANCING] = true;
     engine->options[GAME_LIGHTS_ON] = false;
     engine->options[GAME_HAS_TORCH] = false;
     engine->options[GAME_PICKUP_WOLF] = false;
@@ -212,363 +472,286 @@ void resetGameSettings(Backend* engine)
 }
 
 
-void loop(Backend* engine)
+void initWorld(Backend* engine)
 {
-    float lastTime = glfwGetTime();
-    float currentTime;
-
-    if (! engine)
-        return;
+    World* world = &(engine->world);
+    Box* model;
 
-    while (! glfwWindowShouldClose(engine->window))
+    // The simulation starts from wherever the models were built
+    for (int i = 0; i < MODEL_COUNT; i++)
     {
-        logInfo(stderr, engine);
-        instantKeyInputCallback(engine->window);
-
-        currentTime = glfwGetTime();
-        engine->timeDelta = currentTime - lastTime;
-        lastTime = currentTime;
-
-        // Set sky color depending on light setting
-        if (! engine->options[GAME_LIGHTS_ON])
-            glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-        else
-            glClearColor(0.2f, 0.2f, 0.5f, 1.0f);
+        if (! (model = engine->modelHandles[i]))
+            continue;
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glm_vec3_copy(model->position, world->initialPositions[i]);
+        glm_vec3_copy(model->rotation, world->initialRotations[i]);
+    }
 
-        if (engine->options[GAME_PLAYER_DIE])
-            drawMessage(engine, "game_over");
-        else if (engine->options[GAME_WIN])
-            drawMessage(engine, "game_win");
-        else
-            draw(engine);
+    resetWorld(engine);
 
-        glfwSwapBuffers(engine->window);
-        glfwPollEvents();
-    }
+    takeSnapshot(engine, &(engine->current));
+    memcpy(&(engine->previous), &(engine->current), sizeof(Snapshot));
 }
 
 
-void draw(Backend* engine)
+void initColliders(Backend* engine)
 {
-    vec3 sheepDirection = {0.0f, 0.0f, 1.0f};
-    vec3 temp;
-    float angle = 0.0f;
-
-    Shader* shader;
+    Grid* grid;
 
-    Box* model;
-    Camera* cam;
-
-    mat4 projection;
-    mat4 view;
-
-    cam = engine->cam;
-    glm_mat4_identity(projection);
-    glm_mat4_identity(view);
-    shader = (Shader*)engine->shaders->search(engine->shaders, "shader");
-
-    glfwGetWindowSize(engine->window, &(engine->width), &(engine->height));
+    for (int i = 0; i < MODEL_COUNT; i++)
+        engine->colliderHandles[i] = GRID_NONE;
 
-    // Move camera down if player is dead
-    cam->getViewMatrix(cam, view);
-    setupProjection(engine, cam, projection);
-    setupShader(engine, shader, cam, projection, view);
-
-    // Draw ground
-    model = (Box*)engine->models->search(engine->models, "ground");
-    model->setShader(model, shader);
-    model->draw(model, NULL);
+    if (! (grid = engine->colliders = newGrid(COLLIDER_CELL_SIZE)))
+        return;
 
-    // Draw trees
-    model = (Box*)engine->models->search(engine->models, "tree");
-    model->setShader(model, shader);
-    for (int i = -50; i < 50; i += 10)
+    for (int i = -TRAP_EXTENT; i < TRAP_EXTENT; i += TRAP_SPACING)
     {
-        model->setPosition(model, (vec3){(float)i, 0.0f, 0.0f});
-        model->draw(model, NULL);
-
-        model->setPosition(model, (vec3){0.0f, 0.0f, (float)i});
-        model->draw(model, NULL);
+        grid->add(grid, (vec3){(float)i, 0.0f, 0.0f}, TRAP_RADIUS, COLLIDE_TRAP);
+        grid->add(grid, (vec3){0.0f, 0.0f, (float)i}, TRAP_RADIUS, COLLIDE_TRAP);
     }
 
-    // Draw wolf
-    model = (Box*)engine->models->search(engine->models, "wolf");
-    model->setShader(model, shader);
-    model->draw(model, (void*)engine);
-
-    // Draw sheep
-    if (engine->options[GAME_PICKUP_WOLF])
-    {
-        model = (Box*)engine->models->search(engine->models, "sheep");
-        model->setShader(model, shader);
-
-        // Change angle and direction of vector depending on the player's
-        // x coordinate and the sheep's x coordinate
-        if (engine->cam->position[X_COORD] < model->position[X_COORD])
-        {
-            glm_vec3_sub(model->position, engine->cam->position, temp);
-            angle = 180.0f;
-        }
-        else
-            glm_vec3_sub(engine->cam->position, model->position, temp);
+    grid->add(grid, engine->safeZone, SAFE_ZONE_RADIUS, COLLIDE_SAFE_ZONE);
 
-        // Rotate sheep to the camera
-        angle += (180.0f * glm_vec3_angle(sheepDirection, temp)) / GLM_PI;
-        model->setRotation(model, (vec3){0.0f, angle, 0.0f});
+    engine->colliderHandles[MODEL_SHEEP] = grid->add(grid,
+        engine->world.positions[MODEL_SHEEP], SHEEP_RADIUS, COLLIDE_SHEEP);
+    engine->colliderHandles[MODEL_WOLF] = grid->add(grid,
+        engine->world.positions[MODEL_WOLF], PICKUP_RADIUS, COLLIDE_WOLF);
+    engine->colliderHandles[MODEL_TORCH] = grid->add(grid,
+        engine->world.positions[MODEL_TORCH], PICKUP_RADIUS, COLLIDE_TORCH);
+}
 
-        // Slowly mode the sheep towards the camera
-        glm_vec3_sub(engine->cam->position, model->position, temp);
-        temp[Y_COORD] = 0.0f;
-        glm_vec3_normalize(temp);
-        glm_vec3_scale(temp, 0.09f, temp);
-        model->move(model, temp);
 
-        model->draw(model, (void*)engine);
+void initPicking(Backend* engine)
+{
+    Scene* scene = getBoxScene();
+    Box* model;
+    int* items;
+    int count = 0;
 
-        angle = 0.0f;
+    if (! scene || ! scene->count)
+        return;
 
-        // Check sheep's distance to player
-        engine->options[GAME_PLAYER_DIE] = checkHitbox(engine, model->position, 2.0f);
+    if (! (items = (int*)malloc(scene->count * sizeof(int))))
+    {
+        fprintf(stderr, ERR_BVH_MALLOC);
+        return;
     }
 
-    // Draw traps
-    if (engine->options[GAME_PICKUP_WOLF])
+    // Every box of every pickable model is a leaf of its own
+    for (int i = 0; i < sizeof(pickModels) / sizeof(pickModels[0]); i++)
     {
-        model = (Box*)engine->models->search(engine->models, "trap");
-        model->setShader(model, shader);
-
-        for (int i = -46; i < 46; i += 4)
-        {
-            model->setPosition(model, (vec3){(float)i, -2.0f, 0.0f});
-            model->draw(model, NULL);
-
-            model->setPosition(model, (vec3){0.0f, -2.0f, (float)i});
-            model->draw(model, NULL);
+        if (! (model = engine->modelHandles[pickModels[i]]))
+            continue;
 
-            // Check if player touched a trap
-            engine->options[GAME_PLAYER_DIE] = checkHitbox(engine, (vec3){(float)i, 0.0f, 0.0f}, 0.5f);
-            engine->options[GAME_PLAYER_DIE] = checkHitbox(engine, (vec3){0.0f, 0.0f, (float)i}, 0.5f);
-        }
+        scene->computeWorld(scene, model->index,
+                            scene->subtreeSize[model->index]);
 
-        model->resetPosition(model);
+        for (int j = model->index; j < SCENE_END(scene, model->index); j++)
+            items[count++] = j;
     }
 
-    // Draw table
-    model = (Box*)engine->models->search(engine->models, "table");
-    model->setShader(model, shader);
-    model->draw(model, NULL);
-
-    // Draw torch
-    if (! engine->options[GAME_HAS_TORCH])
+    if ((engine->picking = newBvh()) &&
+        ! engine->picking->build(engine->picking, scene->bounds, items, count))
     {
-        model = (Box*)engine->models->search(engine->models, "torch");
-
-        // "Animate" torch
-        model->move(model, (vec3){0.0f, sin(1.5f * glfwGetTime()) / 180.0f, 0.0f});
-        model->setRotation(model, (vec3){0.0f, glfwGetTime() * 20.0f, 0.0f});
-
-        model->setShader(model, shader);
-        model->draw(model, NULL);
+        engine->picking->destroy(engine->picking);
+        SAFE_FREE(engine->picking);
     }
 
-    // Draw sign
-    model = (Box*)engine->models->search(engine->models, "sign");
-    model->setShader(model, shader);
-    model->draw(model, NULL);
+    SAFE_FREE(items);
+}
 
-    // Draw safe zone
-    model = (Box*)engine->models->search(engine->models, "safe_zone");
-    model->setShader(model, shader);
-    model->draw(model, NULL);
 
-    cam->poll(cam);
+void resetWorld(Backend* engine)
+{
+    World* world = &(engine->world);
+
+    memcpy(world->positions, world->initialPositions, sizeof(world->positions));
+    memcpy(world->rotations, world->initialRotations, sizeof(world->rotations));
 
-    // Check win condition
-    engine->options[GAME_WIN] = engine->options[GAME_PICKUP_WOLF] &&
-                                checkHitbox(engine, engine->safeZone, 0.5f);
+    for (int i = 0; i < MODEL_COUNT; i++)
+        moveCollider(engine, i);
 }
 
 
-void drawMessage(Backend* engine, const char* key)
+void loop(Backend* engine)
 {
-    Camera* cam = engine->cam;
-    Shader* shader = (Shader*)engine->shaders->search(engine->shaders, "shader");
+    double lastTime = getTime();
+    double currentTime;
+    double start;
+    Pacer* pacer;
 
-    mat4 view;
-    mat4 projection;
+    if (! engine || ! (pacer = engine->pacer))
+        return;
 
-    // Setup scene
-    engine->options[GAME_LIGHTS_ON] = true;
+    while (! glfwWindowShouldClose(engine->window))
+    {
+        logInfo(stderr, engine);
 
-    // Move camera to position
-    cam->setPosition(cam, (vec3){-5.0f, 20.0f, 20.0f});
-    cam->resetFront(cam);
+        // Late latch waits out the slack here, before input is polled
+        pacer->latch(pacer);
 
-    // Setup camera view
-    cam->getViewMatrix(cam, view);
-    setupProjection(engine, cam, projection);
-    setupShader(engine, shader, cam, projection, view);
+        currentTime = getTime();
+        engine->accumulator += MIN(currentTime - lastTime, SIM_MAX_FRAME);
+        lastTime = currentTime;
 
-    // Draw the message as a box
-    Box* model = engine->models->search(engine->models, key);
-    model->setShader(model, shader);
-    model->draw(model, NULL);
-}
+        pollInput(engine);
 
+        engine->updateTime = 0.0;
+        engine->updateSteps = 0;
 
-void drawWolfTail(Box* this, mat4 model, void* pointer)
-{
-    static bool direction = true;
-    Backend* engine = (Backend*)pointer;
+        // Gameplay only ever advances in whole steps, whatever is left over
+        // is how far the frame is between the last two states
+        while (engine->accumulator + SIM_EPSILON >= engine->simStep)
+        {
+            start = getWallTime();
+            update(engine, engine->simStep);
+            engine->updateTime += getWallTime() - start;
+            engine->updateSteps++;
 
-    glm_mat4_identity(model);
+            engine->accumulator -= engine->simStep;
+        }
 
-    glm_translate(model, this->position);
+        drawInterpolated(engine, engine->accumulator / engine->simStep);
 
-    // Rotate tail if picked up
-    if (engine->options[GAME_PICKUP_WOLF])
-    {
-        // Change direction periodically
-        direction = sin(glfwGetTime() * 8) > 0.0f;
-        this->setRotationDelta(
-            this, (vec3){0.0f, (direction ? -1 : 1) * 0.5f, 0.0f}
-        );
+        pacer->present(pacer);
     }
 
-    glm_rotate_x(model, glm_rad(this->rotation[X_COORD]), model);
-    glm_rotate_y(model, glm_rad(this->rotation[Y_COORD]), model);
-    glm_rotate_z(model, glm_rad(this->rotation[Z_COORD]), model);
+    pacer->report(pacer, stdout);
+}
 
-    glm_translate(model, this->modelPosition);
 
-    glm_scale(model, this->scale);
+void pollInput(Backend* engine)
+{
+    GLFWwindow* win = engine->window;
+    bool* held = engine->input.held;
+
+    held[CAM_MOVE_FORWARD] = KEY_PRESSED(win, GLFW_KEY_W);
+    held[CAM_MOVE_LEFT] = KEY_PRESSED(win, GLFW_KEY_A);
+    held[CAM_MOVE_BACKWARD] = KEY_PRESSED(win, GLFW_KEY_S);
+    held[CAM_MOVE_RIGHT] = KEY_PRESSED(win, GLFW_KEY_D);
+    held[CAM_JUMP] = KEY_PRESSED(win, GLFW_KEY_SPACE);
+    held[GAME_RESET] = KEY_PRESSED(win, GLFW_KEY_R);
 }
 
 
-void drawSheepLeg(Box* this, mat4 model, void* pointer)
+void update(Backend* engine, float step)
 {
-    static int alternate = 0;
-    float direction;
-
-    glm_mat4_identity(model);
+    engine->timeDelta = step;
 
-    glm_translate(model, this->position);
+    // Presses and mouse movement land before the step, frames are not
+    // blended across them
+    applyEvents(engine);
+    takeSnapshot(engine, &(engine->previous));
 
-    glm_rotate_x(model, glm_rad(this->rotation[X_COORD]), model);
-    glm_rotate_y(model, glm_rad(this->rotation[Y_COORD]), model);
-    glm_rotate_z(model, glm_rad(this->rotation[Z_COORD]), model);
+    applyHeldKeys(engine, step);
 
-    // Alternate diagonal legs
-    switch (alternate)
-    {
-        case 0: case 1: case 4: case 5: direction = -1.0f; break;
-        case 2: case 3: case 6: case 7: direction = 1.0f; break;
-    }
+    engine->simTime += step;
 
-    // Change direction periodically
-    direction *= sin(glfwGetTime() * 4) - 12.5f > 0.0f ? -1.0f : 1.0f;
-    glm_rotate_x(model, direction * sin(glfwGetTime() * 4) / 5.0f, model);
-    glm_translate(model, this->modelPosition);
-    glm_scale(model, this->scale);
+    // Nothing moves behind the game over and win messages
+    if (CHECK_GAME_STATE(engine))
+        simulate(engine, step);
 
-    // Alternate across legs diagonally
-    alternate = (alternate + 1) % 8;
+    takeSnapshot(engine, &(engine->current));
 }
 
 
-bool checkHitbox(Backend* engine, vec3 pos, float distance)
+void applyEvents(Backend* engine)
 {
-    if (engine->options[GAME_PLAYER_DIE])
-        return true;
+    Input* input = &(engine->input);
+    Camera* cam = engine->cam;
+    vec3 temp;
 
-    return glm_vec3_distance(engine->cam->position, pos) < distance;
-}
+    if ((input->mouseX != 0.0 || input->mouseY != 0.0) &&
+        ! engine->options[GAME_PLAYER_DIE])
+    {
+        cam->moveMouse(cam, input->mouseX, input->mouseY, true);
 
+        // A carried wolf stays just in front of the camera, facing along it
+        if (engine->options[GAME_PICKUP_WOLF])
+        {
+            glm_vec3_normalize_to((vec3){cam->front[X_COORD], 0.0f,
+                                         cam->front[Z_COORD]}, temp);
+            glm_vec3_copy((vec3){cam->position[X_COORD] + temp[X_COORD],
+                                 engine->world.positions[MODEL_WOLF][Y_COORD],
+                                 cam->position[Z_COORD] + temp[Z_COORD]},
+                          engine->world.positions[MODEL_WOLF]);
+            glm_vec3_copy((vec3){0.0f, -(cam->yaw - 90.0f), 0.0f},
+                          engine->world.rotations[MODEL_WOLF]);
+            moveCollider(engine, MODEL_WOLF);
+        }
+    }
 
-void setupProjection(Backend* engine, Camera* cam, mat4 projection)
-{
-    if (engine->options[GAME_USE_PERSPECTIVE])
-        glm_perspective(glm_rad(cam->zoom),
-                        ASPECT_RATIO(engine->width, engine->height),
-                        0.1f, 100.0f, projection);
-    else
-        glm_ortho(-((float)engine->width / 200.0f),
-                   (float)engine->width / 200.0f,
-                  -((float)engine->height / 200.0f),
-                   (float)engine->height / 200.0f,
-                  -1000.0f, 1000.0f, projection);
+    if (input->scroll != 0.0)
+        cam->scrollMouse(cam, input->scroll);
+
+    for (int i = 0; i < input->pressedCount; i++)
+        pressKey(engine, input->pressed[i], input->targets[i]);
+
+    input->pressedCount = 0;
+    input->mouseX = 0.0;
+    input->mouseY = 0.0;
+    input->scroll = 0.0;
 }
 
 
-void setupShader(Backend* engine, Shader* shader, Camera* cam,
-                 mat4 projection, mat4 view)
+void applyHeldKeys(Backend* engine, float step)
 {
-    float light = engine->lightLevel;
+    Camera* cam = engine->cam;
+    bool* held = engine->input.held;
+    bool alive = CHECK_GAME_STATE(engine);
+    vec3 before;
+    vec3 temp;
 
-    shader->use(shader);
-    shader->setMat4(shader, "projection", projection);
-    shader->setMat4(shader, "view", view);
-    shader->setVec3(shader, "viewPos", cam->position);
-    shader->setBool(shader, "lightsOn", engine->options[GAME_LIGHTS_ON]);
+    glm_vec3_copy(cam->position, before);
+
+    if (alive && held[CAM_MOVE_FORWARD] && ! held[CAM_MOVE_BACKWARD])
+        cam->moveForward(cam, step);
+    if (alive && held[CAM_MOVE_LEFT] && ! held[CAM_MOVE_RIGHT])
+        cam->moveLeft(cam, step);
+    if (alive && held[CAM_MOVE_BACKWARD] && ! held[CAM_MOVE_FORWARD])
+        cam->moveBackward(cam, step);
+    if (alive && held[CAM_MOVE_RIGHT] && ! held[CAM_MOVE_LEFT])
+        cam->moveRight(cam, step);
+    if (alive && held[CAM_JUMP])
+        cam->setJump(cam, true);
 
-    if (engine->options[GAME_LIGHTS_ON])
-    {
-        shader->setVec3(shader, "light.ambient", (vec3){1.0f, 1.0f, 1.0f});
-        shader->setVec3(shader, "light.diffuse", (vec3){1.0f, 1.0f, 1.0f});
-        shader->setVec3(shader, "light.specular", (vec3){1.0f, 1.0f, 1.0f});
-    }
-    else if (engine->options[GAME_HAS_TORCH])
-    {
-        shader->setVec3(shader, "light.ambient", (vec3){0.2f, 0.2f, 0.2f});
-        shader->setVec3(shader, "light.diffuse", (vec3){0.5f, 0.5f, 0.5f});
-        shader->setVec3(shader, "light.specular", (vec3){1.0f, 1.0f, 1.0f});
-    }
-    else
+    // A carried wolf walks along with the camera
+    if (engine->options[GAME_PICKUP_WOLF])
     {
-        shader->setVec3(shader, "light.ambient", (vec3){0.1f, 0.1f, 0.1f});
-        shader->setVec3(shader, "light.diffuse", (vec3){0.0f, 0.0f, 0.0f});
-        shader->setVec3(shader, "light.specular", (vec3){0.1f, 0.1f, 0.1f});
+        glm_vec3_sub(cam->position, before, temp);
+        temp[Y_COORD] = 0.0f;
+        glm_vec3_add(engine->world.positions[MODEL_WOLF], temp,
+                     engine->world.positions[MODEL_WOLF]);
+        moveCollider(engine, MODEL_WOLF);
     }
 
-    shader->setFloat(shader, "light.constant", 1.0f);
-    shader->setFloat(shader, "light.linear", 0.09f);
-    shader->setFloat(shader, "light.quadratic", 0.032f);
+    // Reset game state
+    if (held[GAME_RESET])
+    {
+        resetGameSettings(engine);
 
-    shader->setVec3(shader, "light.position", cam->position);
-    shader->setVec3(shader, "light.direction", cam->front);
-    shader->setFloat(shader, "light.cutOff", cos(glm_rad(light * 17.5f)));
-    shader->setFloat(shader, "light.outerCutOff", cos(glm_rad(light * 26.25f)));
-}
+        cam->setJump(cam, false);
+        cam->resetPosition(cam);
+        cam->resetFront(cam);
 
+        resetWorld(engine);
 
-void toggleWireframe()
-{
-    static int toggle = 0;
-    toggle = (toggle + 1) % 3;
-    glPolygonMode(GL_FRONT_AND_BACK, toggle == 1 ? GL_LINE :
-                                     toggle == 2 ? GL_POINT :
-                                     GL_FILL);
+        // Nothing to blend from after a restart
+        takeSnapshot(engine, &(engine->previous));
+    }
 }
 
 
-void normalInputCallback(GLFWwindow* win, int key, int scancode,
-                         int action, int mods)
+void pressKey(Backend* engine, int key, int target)
 {
     vec3 temp;
-    Box* model;
-    Backend* engine = (Backend*)glfwGetWindowUserPointer(win);
-
-    if (action != GLFW_PRESS || ! engine)
-        return;
+    Camera* cam = engine->cam;
+    World* world = &(engine->world);
 
     switch (key)
     {
-        case GLFW_KEY_ESCAPE:
-        case GLFW_KEY_Q:    glfwSetWindowShouldClose(win, true); break;
-        case GLFW_KEY_TAB:  toggleWireframe(); break;
         case GLFW_KEY_P:    engine->options[GAME_USE_PERSPECTIVE] ^= 1 ; break;
+        case GLFW_KEY_I:    engine->options[GAME_USE_INSTANCING] ^= 1; break;
         case GLFW_KEY_O:    engine->options[GAME_LIGHTS_ON] ^= 1; break;
 
         case GLFW_KEY_K:
@@ -584,102 +767,598 @@ void normalInputCallback(GLFWwindow* win, int key, int scancode,
             break;
 
         case GLFW_KEY_F:
-            model = (Box*)engine->models->search(engine->models, "torch");
-
             // Set new position for the torch
             if (engine->options[GAME_HAS_TORCH])
             {
-                glm_vec3_copy(engine->cam->front, temp);
+                glm_vec3_copy(cam->front, temp);
                 glm_vec3_normalize_to((vec3){temp[X_COORD], 0.0f, temp[Z_COORD]}, temp);
                 glm_vec3_scale(temp, 2.0f, temp);
-                glm_vec3_add(engine->cam->position, temp, temp);
+                glm_vec3_add(cam->position, temp, world->positions[MODEL_TORCH]);
+                moveCollider(engine, MODEL_TORCH);
 
-                model->setPosition(model, temp);
                 engine->options[GAME_HAS_TORCH] = false;
             }
-            else if (checkHitbox(engine, model->position, 3.0f))
+            else if (target == MODEL_TORCH ||
+                     checkHitbox(engine, COLLIDE_TORCH))
                 engine->options[GAME_HAS_TORCH] = true;
             break;
 
 
         case GLFW_KEY_E:
-            model = (Box*)engine->models->search(engine->models, "wolf");
-
             // Drop wolf
             if (engine->options[GAME_PICKUP_WOLF])
             {
-                engine->cam->detach(engine->cam);
-
                 // Set new position for the wolf
-                glm_vec3_copy(engine->cam->front, temp);
+                glm_vec3_copy(cam->front, temp);
                 glm_vec3_normalize_to((vec3){temp[X_COORD], 0.0f, temp[Z_COORD]}, temp);
                 glm_vec3_scale(temp, 2.0f, temp);
-                glm_vec3_add(engine->cam->position, temp, temp);
+                glm_vec3_add(cam->position, temp, temp);
                 temp[Y_COORD] = -1.35f;
 
-                model->setPosition(model, temp);
+                glm_vec3_copy(temp, world->positions[MODEL_WOLF]);
+                moveCollider(engine, MODEL_WOLF);
+
                 engine->options[GAME_PICKUP_WOLF] = false;
             }
-            else if (checkHitbox(engine, model->position, 3.0f))
-            {
-                // Pickup wolf
-                engine->cam->attach(engine->cam, model);
+            else if (target == MODEL_WOLF ||
+                     checkHitbox(engine, COLLIDE_WOLF))
                 engine->options[GAME_PICKUP_WOLF] = true;
-            }
 
             break;
     }
 }
 
 
-void instantKeyInputCallback(GLFWwindow* win)
+void simulate(Backend* engine, float step)
 {
-    Backend* engine = (Backend*)glfwGetWindowUserPointer(win);
-    Camera* cam = engine ? engine->cam : NULL;
+    vec3 sheepDirection = {0.0f, 0.0f, 1.0f};
+    vec3 temp;
+    float angle = 0.0f;
 
-    Box* box;
-    HashEntry* iter;
+    Camera* cam = engine->cam;
+    World* world = &(engine->world);
+    float* position;
+
+    // Move sheep
+    if (engine->options[GAME_PICKUP_WOLF])
+    {
+        position = world->positions[MODEL_SHEEP];
+
+        // Change angle and direction of vector depending on the player's
+        // x coordinate and the sheep's x coordinate
+        if (cam->position[X_COORD] < position[X_COORD])
+        {
+            glm_vec3_sub(position, cam->position, temp);
+            angle = 180.0f;
+        }
+        else
+            glm_vec3_sub(cam->position, position, temp);
+
+        // Rotate sheep to the camera
+        angle += (180.0f * glm_vec3_angle(sheepDirection, temp)) / GLM_PI;
+        glm_vec3_copy((vec3){0.0f, angle, 0.0f}, world->rotations[MODEL_SHEEP]);
+
+        // Slowly mode the sheep towards the camera
+        glm_vec3_sub(cam->position, position, temp);
+        temp[Y_COORD] = 0.0f;
+        glm_vec3_normalize(temp);
+        glm_vec3_scale(temp, SHEEP_SPEED * step, temp);
+        glm_vec3_add(position, temp, position);
+        moveCollider(engine, MODEL_SHEEP);
+
+        // Check if the sheep caught the player or the player touched a trap
+        engine->options[GAME_PLAYER_DIE] = checkHitbox(engine, COLLIDE_SHEEP |
+                                                               COLLIDE_TRAP);
+    }
+
+    // "Animate" torch
+    if (! engine->options[GAME_HAS_TORCH])
+    {
+        world->positions[MODEL_TORCH][Y_COORD] += sin(1.5f * engine->simTime) *
+                                                  TORCH_BOB_SPEED * step;
+        glm_vec3_copy((vec3){0.0f, engine->simTime * TORCH_SPIN_SPEED, 0.0f},
+                      world->rotations[MODEL_TORCH]);
+        moveCollider(engine, MODEL_TORCH);
+    }
+
+    cam->poll(cam, step);
+
+    // Check win condition
+    engine->options[GAME_WIN] = engine->options[GAME_PICKUP_WOLF] &&
+                                checkHitbox(engine, COLLIDE_SAFE_ZONE);
+}
+
+
+void takeSnapshot(Backend* engine, Snapshot* snapshot)
+{
+    Camera* cam = engine->cam;
+
+    snapshot->time = engine->simTime;
+
+    memcpy(snapshot->options, engine->options, sizeof(snapshot->options));
+    snapshot->lightLevel = engine->lightLevel;
+
+    glm_vec3_copy(cam->position, snapshot->camPosition);
+    glm_vec3_copy(cam->front, snapshot->camFront);
+    glm_vec3_copy(cam->up, snapshot->camUp);
+    snapshot->zoom = cam->zoom;
+
+    memcpy(snapshot->positions, engine->world.positions,
+           sizeof(snapshot->positions));
+    memcpy(snapshot->rotations, engine->world.rotations,
+           sizeof(snapshot->rotations));
+}
+
+
+void lerpSnapshot(Snapshot* from, Snapshot* to, float alpha, Snapshot* dest)
+{
+    float delta;
+
+    // Settings and the view direction only change between steps, so they
+    // are taken as they are after it
+    memcpy(dest, to, sizeof(Snapshot));
+
+    dest->time = from->time + alpha * (to->time - from->time);
+    glm_vec3_lerp(from->camPosition, to->camPosition, alpha, dest->camPosition);
+
+    for (int i = 0; i < MODEL_COUNT; i++)
+    {
+        glm_vec3_lerp(from->positions[i], to->positions[i], alpha,
+                      dest->positions[i]);
+
+        // Angles are in degrees, turn the short way round
+        for (int j = 0; j < 3; j++)
+        {
+            delta = fmodf(to->rotations[i][j] - from->rotations[i][j], 360.0f);
+            delta += delta > 180.0f ? -360.0f : delta < -180.0f ? 360.0f : 0.0f;
+            dest->rotations[i][j] = from->rotations[i][j] + alpha * delta;
+        }
+    }
+}
+
+
+void applySnapshot(Backend* engine, Snapshot* snapshot)
+{
+    Box* model;
+
+    // Only touch what differs, anything set has its matrices recomputed
+    for (int i = 0; i < MODEL_COUNT; i++)
+    {
+        if (! (model = engine->modelHandles[i]))
+            continue;
+
+        if (! glm_vec3_eqv(model->position, snapshot->positions[i]))
+            model->setPosition(model, snapshot->positions[i]);
+        if (! glm_vec3_eqv(model->rotation, snapshot->rotations[i]))
+            model->setRotation(model, snapshot->rotations[i]);
+    }
+}
+
+
+void drawInterpolated(Backend* engine, float alpha)
+{
+    Snapshot blended;
+
+    // Draw a blend of the last two steps, the simulation itself is untouched
+    lerpSnapshot(&(engine->previous), &(engine->current),
+                 CLAMP(alpha, 0.0f, 1.0f), &blended);
 
-    if (! cam)
+    if (engine->pacer && engine->pacer->mode == PACE_LATE_LATCH)
+        latchView(engine, &blended);
+
+    drawFrame(engine, &blended);
+}
+
+
+void latchView(Backend* engine, Snapshot* snapshot)
+{
+    Input* input = &(engine->input);
+    Camera latched;
+
+    if ((input->mouseX == 0.0 && input->mouseY == 0.0) ||
+        engine->options[GAME_PLAYER_DIE])
         return;
 
-    bool keys[] = {
-        KEY_PRESSED(win, GLFW_KEY_W) && CHECK_GAME_STATE(engine),
-        KEY_PRESSED(win, GLFW_KEY_A) && CHECK_GAME_STATE(engine),
-        KEY_PRESSED(win, GLFW_KEY_S) && CHECK_GAME_STATE(engine),
-        KEY_PRESSED(win, GLFW_KEY_D) && CHECK_GAME_STATE(engine),
-        KEY_PRESSED(win, GLFW_KEY_SPACE) && CHECK_GAME_STATE(engine),
-
-        KEY_PRESSED(win, GLFW_KEY_R)
-    };
-
-    if (keys[CAM_MOVE_FORWARD] && ! keys[CAM_MOVE_BACKWARD])
-        cam->moveForward(cam, engine->timeDelta);
-    if (keys[CAM_MOVE_LEFT] && ! keys[CAM_MOVE_RIGHT])
-        cam->moveLeft(cam, engine->timeDelta);
-    if (keys[CAM_MOVE_BACKWARD] && ! keys[CAM_MOVE_FORWARD])
-        cam->moveBackward(cam, engine->timeDelta);
-    if (keys[CAM_MOVE_RIGHT] && ! keys[CAM_MOVE_LEFT])
-        cam->moveRight(cam, engine->timeDelta);
-    if (keys[CAM_JUMP])
-        cam->setJump(cam, true);
+    // Mouse movement polled since the last step is drawn straight away,
+    // turned the same way the next step will turn the camera itself
+    latched = *(engine->cam);
+    latched.moveMouse(&latched, input->mouseX, input->mouseY, true);
 
-    // Reset game state
-    if (keys[GAME_RESET])
+    glm_vec3_copy(latched.front, snapshot->camFront);
+    glm_vec3_copy(latched.up, snapshot->camUp);
+}
+
+
+void drawFrame(Backend* engine, Snapshot* snapshot)
+{
+    bool message = snapshot->options[GAME_PLAYER_DIE] ||
+                   snapshot->options[GAME_WIN];
+
+    // Set sky color depending on light setting, messages are always lit
+    if (! snapshot->options[GAME_LIGHTS_ON] && ! message)
+        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+    else
+        glClearColor(0.2f, 0.2f, 0.5f, 1.0f);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    engine->renderer->resetStats(engine->renderer);
+    getBoxScene()->resetStats(getBoxScene());
+
+    applySnapshot(engine, snapshot);
+
+    if (snapshot->options[GAME_PLAYER_DIE])
+        drawMessage(engine, snapshot, MODEL_GAME_OVER);
+    else if (snapshot->options[GAME_WIN])
+        drawMessage(engine, snapshot, MODEL_GAME_WIN);
+    else
+        draw(engine, snapshot);
+}
+
+
+void draw(Backend* engine, Snapshot* snapshot)
+{
+    mat4 instances[MAX_INSTANCES];
+    int count = 0;
+
+    Shader* shader;
+
+    Box* model;
+
+    mat4 projection;
+    mat4 view;
+    mat4 viewProjection;
+
+    glm_mat4_identity(projection);
+    glm_mat4_identity(view);
+    shader = engine->shaderHandles[SHADER_DEFAULT];
+
+    // Offscreen runs keep the size they were created with
+    if (engine->window)
+        glfwGetWindowSize(engine->window, &(engine->width), &(engine->height));
+
+    setupView(snapshot, view);
+    setupProjection(engine, snapshot, projection);
+    setupShader(engine, shader, snapshot, projection, view);
+
+    // Boxes outside the camera's view are culled before submission
+    glm_mat4_mul(projection, view, viewProjection);
+    engine->renderer->setFrustum(engine->renderer, viewProjection);
+
+    // Draw ground, table, sign and safe zone
+    engine->scenery->draw(engine->scenery, engine->renderer, shader);
+
+    // Draw trees
+    model = engine->modelHandles[MODEL_TREE];
+    model->setShader(model, shader);
+    for (int i = -50; i < 50; i += 10)
     {
-        resetGameSettings(engine);
+        if (snapshot->options[GAME_USE_INSTANCING])
+        {
+            addInstance(model, instances, &count, (vec3){(float)i, 0.0f, 0.0f});
+            addInstance(model, instances, &count, (vec3){0.0f, 0.0f, (float)i});
+        }
+        else
+        {
+            model->setPosition(model, (vec3){(float)i, 0.0f, 0.0f});
+            model->draw(model, NULL);
 
-        cam->setJump(cam, false);
-        cam->resetPosition(cam);
-        cam->resetFront(cam);
-        cam->detach(cam);
+            model->setPosition(model, (vec3){0.0f, 0.0f, (float)i});
+            model->draw(model, NULL);
+        }
+    }
 
-        HASHTABLE_FOR_EACH(engine->models, iter)
+    model->resetPosition(model);
+    model->drawInstanced(model, instances, count, NULL);
+    count = 0;
+
+    // Draw wolf
+    model = engine->modelHandles[MODEL_WOLF];
+    model->setShader(model, shader);
+    model->draw(model, (void*)snapshot);
+
+    // Draw sheep
+    if (snapshot->options[GAME_PICKUP_WOLF])
+    {
+        model = engine->modelHandles[MODEL_SHEEP];
+        model->setShader(model, shader);
+        model->draw(model, (void*)snapshot);
+    }
+
+    // Draw traps
+    if (snapshot->options[GAME_PICKUP_WOLF])
+    {
+        model = engine->modelHandles[MODEL_TRAP];
+        model->setShader(model, shader);
+
+        for (int i = -TRAP_EXTENT; i < TRAP_EXTENT; i += TRAP_SPACING)
         {
-            box = (Box*)iter->value;
-            box->resetPosition(box);
-            box->resetRotation(box);
+            if (snapshot->options[GAME_USE_INSTANCING])
+            {
+                addInstance(model, instances, &count, (vec3){(float)i, -2.0f, 0.0f});
+                addInstance(model, instances, &count, (vec3){0.0f, -2.0f, (float)i});
+            }
+            else
+            {
+                model->setPosition(model, (vec3){(float)i, -2.0f, 0.0f});
+                model->draw(model, NULL);
+
+                model->setPosition(model, (vec3){0.0f, -2.0f, (float)i});
+                model->draw(model, NULL);
+            }
         }
+
+        model->resetPosition(model);
+        model->drawInstanced(model, instances, count, NULL);
+        count = 0;
+    }
+
+    // Draw torch
+    if (! snapshot->options[GAME_HAS_TORCH])
+    {
+        model = engine->modelHandles[MODEL_TORCH];
+        model->setShader(model, shader);
+        model->draw(model, NULL);
+    }
+
+    engine->renderer->flush(engine->renderer);
+}
+
+
+// Translated copies of the model, drawn in one go once the array is full so
+// any number of them fit. The model sits at its reset position whenever
+// instancing is on, so a batch drawn early lands where the last one will
+void addInstance(Box* model, mat4* instances, int* count, vec3 position)
+{
+    if (*count == MAX_INSTANCES)
+    {
+        model->drawInstanced(model, instances, *count, NULL);
+        *count = 0;
+    }
+
+    glm_translate_make(instances[(*count)++], position);
+}
+
+
+void drawMessage(Backend* engine, Snapshot* snapshot, ModelHandle handle)
+{
+    Shader* shader = engine->shaderHandles[SHADER_DEFAULT];
+    Snapshot message;
+
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+
+    // Messages are lit and seen from a fixed spot, whatever the game state
+    memcpy(&message, snapshot, sizeof(Snapshot));
+    message.options[GAME_LIGHTS_ON] = true;
+    glm_vec3_copy((vec3){-5.0f, 20.0f, 20.0f}, message.camPosition);
+    glm_vec3_copy((vec3){0.0f, 0.0f, -1.0f}, message.camFront);
+    glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, message.camUp);
+
+    // Setup camera view
+    setupView(&message, view);
+    setupProjection(engine, &message, projection);
+    setupShader(engine, shader, &message, projection, view);
+
+    glm_mat4_mul(projection, view, viewProjection);
+    engine->renderer->setFrustum(engine->renderer, viewProjection);
+
+    // Draw the message as a box
+    Box* model = engine->modelHandles[handle];
+    model->setShader(model, shader);
+    model->draw(model, NULL);
+
+    engine->renderer->flush(engine->renderer);
+}
+
+
+void drawWolfTail(Box* this, mat4 model, void* pointer)
+{
+    Snapshot* snapshot = (Snapshot*)pointer;
+    float wag = 0.0f;
+
+    glm_mat4_identity(model);
+
+    glm_translate(model, this->position);
+
+    // Wag the tail if picked up. A triangle wave in time, swinging at
+    // TAIL_WAG_SPEED degrees a second, so the frame rate does not change it
+    if (snapshot->options[GAME_PICKUP_WOLF])
+        wag = TAIL_WAG_SPEED / 8.0f * asinf(cosf(snapshot->time * 8.0f));
+
+    glm_rotate_x(model, glm_rad(this->rotation[X_COORD]), model);
+    glm_rotate_y(model, glm_rad(this->rotation[Y_COORD] + wag), model);
+    glm_rotate_z(model, glm_rad(this->rotation[Z_COORD]), model);
+
+    glm_translate(model, this->modelPosition);
+
+    glm_scale(model, this->scale);
+}
+
+
+void drawSheepLeg(Box* this, mat4 model, void* pointer)
+{
+    Snapshot* snapshot = (Snapshot*)pointer;
+    float direction;
+
+    glm_mat4_identity(model);
+
+    glm_translate(model, this->position);
+
+    glm_rotate_x(model, glm_rad(this->rotation[X_COORD]), model);
+    glm_rotate_y(model, glm_rad(this->rotation[Y_COORD]), model);
+    glm_rotate_z(model, glm_rad(this->rotation[Z_COORD]), model);
+
+    // Diagonally opposite legs swing together
+    direction = this->modelPosition[X_COORD] *
+                this->modelPosition[Z_COORD] > 0.0f ? -1.0f : 1.0f;
+
+    glm_rotate_x(model, direction * sin(snapshot->time * 4) / 5.0f, model);
+    glm_translate(model, this->modelPosition);
+    glm_scale(model, this->scale);
+}
+
+
+void moveCollider(Backend* engine, ModelHandle handle)
+{
+    int collider = engine->colliderHandles[handle];
+
+    if (engine->colliders && collider != GRID_NONE)
+        engine->colliders->move(engine->colliders, collider,
+                                engine->world.positions[handle]);
+}
+
+
+int pickModel(Backend* engine)
+{
+    Scene* scene = getBoxScene();
+    Snapshot* view = &(engine->current);
+    Box* model;
+    int hit;
+
+    if (! engine->picking)
+        return MODEL_COUNT;
+
+    // Bounds are as the boxes were last placed for drawing, anything moved
+    // since is brought up to date first
+    for (int i = 0; i < sizeof(pickModels) / sizeof(pickModels[0]); i++)
+        if ((model = engine->modelHandles[pickModels[i]]))
+            scene->computeWorld(scene, model->index,
+                                scene->subtreeSize[model->index]);
+
+    engine->picking->refit(engine->picking, scene->bounds);
+
+    hit = engine->picking->raycast(engine->picking, view->camPosition,
+                                   view->camFront, PICK_REACH, NULL);
+
+    if (hit == BVH_MISS)
+        return MODEL_COUNT;
+
+    while (scene->parent[hit] != SCENE_ROOT)
+        hit = scene->parent[hit];
+
+    for (int i = 0; i < MODEL_COUNT; i++)
+        if ((model = engine->modelHandles[i]) && model->index == hit)
+            return i;
+
+    return MODEL_COUNT;
+}
+
+
+bool checkHitbox(Backend* engine, unsigned int mask)
+{
+    int hit;
+
+    if (! engine->colliders)
+        return false;
+
+    // Only the cells around the player are looked at
+    return engine->colliders->queryRadius(engine->colliders,
+                                          engine->cam->position, 0.0f, mask,
+                                          &hit, 1) > 0;
+}
+
+
+void setupView(Snapshot* snapshot, mat4 view)
+{
+    vec3 temp;
+    glm_vec3_add(snapshot->camPosition, snapshot->camFront, temp);
+    glm_lookat(snapshot->camPosition, temp, snapshot->camUp, view);
+}
+
+
+void setupProjection(Backend* engine, Snapshot* snapshot, mat4 projection)
+{
+    if (snapshot->options[GAME_USE_PERSPECTIVE])
+        glm_perspective(glm_rad(snapshot->zoom),
+                        ASPECT_RATIO(engine->width, engine->height),
+                        0.1f, 100.0f, projection);
+    else
+        glm_ortho(-((float)engine->width / 200.0f),
+                   (float)engine->width / 200.0f,
+                  -((float)engine->height / 200.0f),
+                   (float)engine->height / 200.0f,
+                  -1000.0f, 1000.0f, projection);
+}
+
+
+void setupShader(Backend* engine, Shader* shader, Snapshot* snapshot,
+                 mat4 projection, mat4 view)
+{
+    float light = snapshot->lightLevel;
+    LightingVariant variant = LIGHTING_DARK;
+    FrameUniforms frame;
+
+    // Light colours are compiled into each variant, only pick which one
+    if (snapshot->options[GAME_LIGHTS_ON])
+        variant = LIGHTING_ON;
+    else if (snapshot->options[GAME_HAS_TORCH])
+        variant = LIGHTING_TORCH;
+
+    engine->renderer->setShaderKey(engine->renderer, variant);
+    shader->setVariant(shader, variant);
+
+    // Camera and light go out once in the frame block, variants without the
+    // spot light simply never read the rest of it
+    glm_mat4_copy(projection, frame.projection);
+    glm_mat4_copy(view, frame.view);
+    glm_vec4(snapshot->camPosition, 1.0f, frame.viewPos);
+    glm_vec4(snapshot->camPosition, 1.0f, frame.lightPosition);
+    glm_vec4(snapshot->camFront, 0.0f, frame.lightDirection);
+    frame.cutOff = cos(glm_rad(light * 17.5f));
+    frame.outerCutOff = cos(glm_rad(light * 26.25f));
+    frame.constant = 1.0f;
+    frame.linear = 0.09f;
+    frame.quadratic = 0.032f;
+
+    engine->renderer->setFrame(engine->renderer, &frame);
+}
+
+
+void toggleWireframe()
+{
+    static int toggle = 0;
+    toggle = (toggle + 1) % 3;
+    glPolygonMode(GL_FRONT_AND_BACK, toggle == 1 ? GL_LINE :
+                                     toggle == 2 ? GL_POINT :
+                                     GL_FILL);
+}
+
+
+void normalInputCallback(GLFWwindow* win, int key, int scancode,
+                         int action, int mods)
+{
+    Backend* engine = (Backend*)glfwGetWindowUserPointer(win);
+    Input* input;
+
+    if (action != GLFW_PRESS || ! engine)
+        return;
+
+    input = &(engine->input);
+
+    // Only the window and GL state are changed here, gameplay keys wait for
+    // the next update()
+    switch (key)
+    {
+        case GLFW_KEY_ESCAPE:
+        case GLFW_KEY_Q:    glfwSetWindowShouldClose(win, true); break;
+        case GLFW_KEY_TAB:  toggleWireframe(); break;
+
+        case GLFW_KEY_V:
+            if (engine->pacer)
+                engine->pacer->cycleMode(engine->pacer);
+            break;
+
+        default:
+            if (input->pressedCount == MAX_KEY_EVENTS)
+                break;
+
+            // Looking at something is only known here, where the boxes are
+            input->targets[input->pressedCount] =
+                key == GLFW_KEY_E || key == GLFW_KEY_F ? pickModel(engine)
+                                                       : MODEL_COUNT;
+            input->pressed[input->pressedCount++] = key;
+            break;
     }
 }
 
@@ -690,13 +1369,9 @@ void mouseCallback(GLFWwindow* win, double x, double y)
     static double lastX = 0.0f;
     static double lastY = 0.0f;
 
-    float xoffset;
-    float yoffset;
-
     Backend* engine = (Backend*)glfwGetWindowUserPointer(win);
-    Camera* cam = engine ? engine->cam : NULL;
 
-    if (! cam || engine->options[GAME_PLAYER_DIE])
+    if (! engine)
         return;
 
     if (first)
@@ -706,23 +1381,20 @@ void mouseCallback(GLFWwindow* win, double x, double y)
         first = false;
     }
 
-    xoffset = x - lastX;
-    yoffset = lastY - y;
+    engine->input.mouseX += x - lastX;
+    engine->input.mouseY += lastY - y;
 
     lastX = x;
     lastY = y;
-
-    cam->moveMouse(cam, xoffset, yoffset, true);
 }
 
 
 void scrollCallback(GLFWwindow* win, double xoffset, double yoffset)
 {
     Backend* engine = (Backend*)glfwGetWindowUserPointer(win);
-    Camera* cam = engine ? engine->cam : NULL;
 
-    if (cam)
-        cam->scrollMouse(cam, yoffset);
+    if (engine)
+        engine->input.scroll += yoffset;
 }
 
 
@@ -736,29 +1408,74 @@ void terminate(Backend** engine)
 {
     Backend* _engine = *engine;
 
-    Box* box;
-    HashEntry* iter;
-
-    glDeleteVertexArrays(1, &(_engine->VAO));
-    glDeleteBuffers(1, &(_engine->VBO));
-
     if (! _engine)
+    {
+        glfwTerminate();
         return;
+    }
 
-    HASHTABLE_FOR_EACH(_engine->models, iter)
+    // Without a context there is nothing on the GL side to delete, and the
+    // renderer, models, textures and shaders were never made
+    if (_engine->renderer)
     {
-        box = (Box*)iter->value;
-        box->destroy(box);
-        _engine->models->delete(_engine->models, iter->key);
+        glDeleteVertexArrays(1, &(_engine->VAO));
+        glDeleteBuffers(1, &(_engine->VBO));
     }
 
-    _engine->textures->deleteHashTable(&(_engine->textures));
-    _engine->shaders->deleteHashTable(&(_engine->shaders));
+    if (_engine->pacer)
+    {
+        _engine->pacer->destroy(_engine->pacer);
+        SAFE_FREE(_engine->pacer);
+    }
+
+    if (_engine->picking)
+    {
+        _engine->picking->destroy(_engine->picking);
+        SAFE_FREE(_engine->picking);
+    }
+
+    if (_engine->colliders)
+    {
+        _engine->colliders->destroy(_engine->colliders);
+        SAFE_FREE(_engine->colliders);
+    }
+
+    if (_engine->scenery)
+    {
+        _engine->scenery->destroy(_engine->scenery);
+        SAFE_FREE(_engine->scenery);
+    }
 
-    _engine->cam->destroy(_engine->cam);
+    // Every model goes at once with the pools it lives in, instead of each
+    // box, list and material being handed back one by one
+    if (_engine->models)
+        _engine->models->deleteHashTable(&(_engine->models));
+    deleteBoxes();
+    freePools();
+
+    if (_engine->textures)
+    {
+        deleteTextures(_engine->textureHandles, TEXTURE_COUNT);
+        _engine->textures->deleteHashTable(&(_engine->textures));
+    }
+
+    if (_engine->shaders)
+        _engine->shaders->deleteHashTable(&(_engine->shaders));
+
+    if (_engine->cam)
+    {
+        _engine->cam->destroy(_engine->cam);
+        SAFE_FREE(_engine->cam);
+    }
+
+    if (_engine->renderer)
+    {
+        _engine->renderer->destroy(_engine->renderer);
+        SAFE_FREE(_engine->renderer);
+    }
 
     free(_engine);
-    _engine = NULL;
+    *engine = NULL;
 
     glfwTerminate();
 }
@@ -4,18 +4,73 @@
 #include <cglm/vec3.h>
 #include <stdio.h>
 
+#include "bake.h"
+#include "bvh.h"
 #include "camera.h"
+#include "grid.h"
 #include "hashtable.h"
 #include "list.h"
+#include "loader.h"
+#include "pack.h"
+#include "pacer.h"
+#include "renderer.h"
 #include "shader.h"
+#include "texture.h"
 
 #define WIDTH 1440
 #define HEIGHT 900
 #define TITLE "CG Assignment"
 
+// Instances gathered on the stack before they are handed to the renderer,
+// which keeps its own growable copy. More than this are drawn in batches
+#define MAX_INSTANCES 64
+
+// Gameplay runs in fixed steps of 1 / SIM_RATE seconds whatever the frame
+// rate, the rate can be lowered with SIM_RATE_FLAG on slow machines
+#define SIM_RATE 60.0
+#define SIM_RATE_FLAG "--sim-rate"
+
+// Longest frame that is caught up on in full, slower frames play in slow
+// motion instead of taking ever more steps to catch up
+#define SIM_MAX_FRAME 0.25
+
+// Frames this close to a whole number of steps count as whole, so a clock
+// ticking at exactly the simulation rate never skips or doubles a step
+#define SIM_EPSILON 1e-6
+
+// Speeds per second, the originals were per frame at 60 fps
+#define SHEEP_SPEED 5.4f
+#define TORCH_BOB_SPEED (1.0f / 3.0f)
+#define TORCH_SPIN_SPEED 20.0f
+#define TAIL_WAG_SPEED 30.0f
+
+// Traps line both axes out to TRAP_EXTENT, TRAP_SPACING apart
+#define TRAP_EXTENT 46
+#define TRAP_SPACING 4
+
+// How close the player has to get for each collider to count
+#define TRAP_RADIUS 0.5f
+#define SHEEP_RADIUS 2.0f
+#define PICKUP_RADIUS 3.0f
+#define SAFE_ZONE_RADIUS 0.5f
+
+// Furthest the player can reach for something they are looking at
+#define PICK_REACH 5.0f
+
+// About a trap spacing, so a query near the traps only sees a few of them
+#define COLLIDER_CELL_SIZE 4.0f
+
+// Key presses queued between steps, any more in one frame are dropped
+#define MAX_KEY_EVENTS 32
+
+// Built next to the binary, loose files are used when it is missing
+#define ASSET_PACK "assets.pack"
+#define TEXTURE_PATH "resources/%s.png"
+
 #define ERR_ENGINE_MALLOC "Error: Unable to allocate memory for engine\n"
 #define ERR_WINDOW "Error: failed to initialise window\n"
 #define ERR_GLAD "Error: failed to initialise GLAD\n"
+#define ERR_HANDLE "Error: unable to resolve handle for \"%s\"\n"
 
 
 typedef enum
@@ -26,13 +81,16 @@ typedef enum
     CAM_MOVE_RIGHT,
     CAM_JUMP,
 
-    GAME_RESET
+    GAME_RESET,
+
+    KEY_ACTION_COUNT
 } KeyAction;
 
 
 typedef enum
 {
     GAME_USE_PERSPECTIVE,
+    GAME_USE_INSTANCING,
     GAME_LIGHTS_ON,
     GAME_HAS_TORCH,
 
@@ -44,6 +102,131 @@ typedef enum
 } GameOptions;
 
 
+// Assets are looked up by name once at init, the per frame path only indexes
+// the handle arrays in Backend
+typedef enum
+{
+    SHADER_DEFAULT,
+
+    SHADER_COUNT
+} ShaderHandle;
+
+
+// Variants of every shader, one per lighting setup. Each is compiled with
+// only the lighting maths it needs
+typedef enum
+{
+    LIGHTING_ON,
+    LIGHTING_TORCH,
+    LIGHTING_DARK,
+
+    LIGHTING_COUNT
+} LightingVariant;
+
+
+typedef enum
+{
+    TEXTURE_BLACK,
+    TEXTURE_GAME_OVER,
+    TEXTURE_GAME_WIN,
+    TEXTURE_GRASS,
+    TEXTURE_GREY,
+    TEXTURE_RED,
+    TEXTURE_SAFE_ZONE,
+    TEXTURE_SHEEP_FACE,
+    TEXTURE_SHEEP_SKIN,
+    TEXTURE_SIGN_1,
+    TEXTURE_SIGN_2,
+    TEXTURE_TABLE,
+    TEXTURE_TREE_1,
+    TEXTURE_TREE_2,
+    TEXTURE_WHITE,
+    TEXTURE_WOLF_FACE,
+
+    TEXTURE_COUNT
+} TextureHandle;
+
+
+typedef enum
+{
+    MODEL_GROUND,
+    MODEL_TREE,
+    MODEL_WOLF,
+    MODEL_SHEEP,
+    MODEL_TABLE,
+    MODEL_TORCH,
+    MODEL_SIGN,
+    MODEL_TRAP,
+    MODEL_SAFE_ZONE,
+    MODEL_GAME_OVER,
+    MODEL_GAME_WIN,
+
+    MODEL_COUNT
+} ModelHandle;
+
+
+// Kinds of collider in the spatial grid, hit tests ask for any of a mask
+typedef enum
+{
+    COLLIDE_TRAP = 1 << 0,
+    COLLIDE_SHEEP = 1 << 1,
+    COLLIDE_WOLF = 1 << 2,
+    COLLIDE_TORCH = 1 << 3,
+    COLLIDE_SAFE_ZONE = 1 << 4
+} ColliderMask;
+
+
+// Input gathered on the main thread and handed to the next update(). The
+// callbacks only record it, so all game state changes inside update()
+typedef struct Input
+{
+    int pressed[MAX_KEY_EVENTS];
+    int pressedCount;
+
+    // Model under the crosshair as each key went down, MODEL_COUNT for none
+    int targets[MAX_KEY_EVENTS];
+
+    // Sampled once a frame, every step in the frame sees the same keys
+    bool held[KEY_ACTION_COUNT];
+
+    double mouseX;
+    double mouseY;
+    double scroll;
+} Input;
+
+
+// Where the simulation keeps every model. Boxes belong to rendering and only
+// ever see these through a Snapshot
+typedef struct World
+{
+    vec3 positions[MODEL_COUNT];
+    vec3 rotations[MODEL_COUNT];
+
+    vec3 initialPositions[MODEL_COUNT];
+    vec3 initialRotations[MODEL_COUNT];
+} World;
+
+
+// Everything a frame needs to be drawn, written by update() and only read
+// after that. Drawing never looks at the live simulation, so update() is free
+// to run on another thread once it hands over a copy
+typedef struct Snapshot
+{
+    double time;
+
+    bool options[GAME_OPTION_COUNT];
+    float lightLevel;
+
+    vec3 camPosition;
+    vec3 camFront;
+    vec3 camUp;
+    float zoom;
+
+    vec3 positions[MODEL_COUNT];
+    vec3 rotations[MODEL_COUNT];
+} Snapshot;
+
+
 typedef struct Backend
 {
     GLFWwindow* window;
@@ -56,38 +239,98 @@ typedef struct Backend
     Camera* cam;
     float timeDelta;
 
+    // Seconds per step, time simulated so far and time not yet simulated
+    double simStep;
+    double simTime;
+    double accumulator;
+
+    Input input;
+    World world;
+
+    // Everything the player can touch, moved along with the world
+    Grid* colliders;
+    int colliderHandles[MODEL_COUNT];
+
+    // Boxes that rays can hit, refitted from the drawn scene before a cast
+    Bvh* picking;
+
+    // When input is polled and frames presented, windowed runs only
+    Pacer* pacer;
+
+    // State before and after the last step, frames are drawn between them
+    Snapshot previous;
+    Snapshot current;
+
+    // Time spent in update() over the last frame
+    double updateTime;
+    int updateSteps;
+
     int width;
     int height;
 
     float lightLevel;
 
+    Renderer* renderer;
+
+    // Name lookup, kept for init and tooling
     HashTable* textures;
     HashTable* shaders;
     HashTable* models;
+
+    Shader* shaderHandles[SHADER_COUNT];
+    Texture* textureHandles[TEXTURE_COUNT];
+    Box* modelHandles[MODEL_COUNT];
+
+    // Models that never move, drawn from a few pre-transformed buffers
+    BakedScene* scenery;
 } Backend;
 
 
-Backend* init(void);
+struct Bench;
+
+Backend* init(struct Bench*);
 void initWindow(Backend*);
 void initGlad(Backend*);
-void initShader(Backend*);
-void initTextures(Backend*);
+void initShader(Backend*, Pack*);
+void finishShaders(Backend*, int*, int*);
+Loader* startTextureLoader(void);
+void initTextures(Backend*, Pack*, Loader*);
 void initShapes(Backend*);
+void resolveHandles(HashTable*, const char**, void**, int);
+void initWorld(Backend*);
+void initColliders(Backend*);
+void initPicking(Backend*);
 void resetGameSettings(Backend*);
+void resetWorld(Backend*);
 
 void loop(Backend*);
-void draw(Backend*);
-void drawMessage(Backend*, const char*);
+void pollInput(Backend*);
+void update(Backend*, float);
+void applyEvents(Backend*);
+void applyHeldKeys(Backend*, float);
+void pressKey(Backend*, int, int);
+void simulate(Backend*, float);
+void takeSnapshot(Backend*, Snapshot*);
+void lerpSnapshot(Snapshot*, Snapshot*, float, Snapshot*);
+void applySnapshot(Backend*, Snapshot*);
+void drawInterpolated(Backend*, float);
+void latchView(Backend*, Snapshot*);
+void drawFrame(Backend*, Snapshot*);
+void draw(Backend*, Snapshot*);
+void addInstance(Box*, mat4*, int*, vec3);
+void drawMessage(Backend*, Snapshot*, ModelHandle);
 
 void drawWolfTail(Box*, mat4, void*);
 void drawSheepLeg(Box*, mat4, void*);
-bool checkHitbox(Backend*, vec3, float);
+void moveCollider(Backend*, ModelHandle);
+int pickModel(Backend*);
+bool checkHitbox(Backend*, unsigned int);
 
-void setupProjection(Backend*, Camera*, mat4);
-void setupShader(Backend*, Shader*, Camera*, mat4, mat4);
+void setupView(Snapshot*, mat4);
+void setupProjection(Backend*, Snapshot*, mat4);
+void setupShader(Backend*, Shader*, Snapshot*, mat4, mat4);
 void toggleWireframe(void);
 void normalInputCallback(GLFWwindow*, int, int, int, int);
-void instantKeyInputCallback(GLFWwindow*);
 void mouseCallback(GLFWwindow*, double, double);
 void scrollCallback(GLFWwindow*, double, double);
 void framebufferSizeCallback(GLFWwindow*, int, int);
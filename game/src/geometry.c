@@ -0,0 +1,459 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cglm/mat4.h>
+#include <cglm/vec3.h>
+
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashtable.h"
+#include "macros.h"
+
+#include "geometry.h"
+
+
+// Geometry shared across everything that draws it, keyed by name
+static HashTable* registry = NULL;
+
+static unsigned int instanceVBO = 0;
+static unsigned int boundVAO = 0;
+
+static const float CUBE_VERTICES[] = {
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
+
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+
+     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
+     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+     0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
+};
+
+
+static void linkMethods(Geometry*);
+static bool setGlBuffers(Geometry*, const float*);
+static int packVertices(const float*, int, PackedVertex*, uint32_t*);
+static void packVertex(const float*, PackedVertex*);
+static uint32_t packNormal(const float*);
+static uint16_t packHalf(float);
+static void setBounds(Geometry*, const float*);
+
+static void bind(Geometry*);
+static void setInstanceOffset(Geometry*, int);
+static void setInstanceAttribs(int);
+static void draw(Geometry*, int);
+static void release(Geometry*);
+
+
+Geometry* acquireGeometry(const char* name, const float* vertices,
+                          int vertexCount)
+{
+    Geometry* geometry;
+
+    if (! registry)
+        registry = newHashTable();
+
+    if ((geometry = (Geometry*)registry->search(registry, name)))
+    {
+        geometry->refCount++;
+        return geometry;
+    }
+
+    if (! (geometry = (Geometry*)malloc(sizeof(Geometry))))
+    {
+        fprintf(stderr, ERR_GEOMETRY_MALLOC);
+        return NULL;
+    }
+
+    memset(geometry, 0, sizeof(Geometry));
+    linkMethods(geometry);
+
+    strncpy(geometry->name, name, GEOMETRY_NAME_SIZE - 1);
+    geometry->vertexCount = vertexCount;
+    geometry->refCount = 1;
+    geometry->vertices = vertices;
+
+    if (! setGlBuffers(geometry, vertices))
+    {
+        SAFE_FREE(geometry);
+        return NULL;
+    }
+
+    setBounds(geometry, vertices);
+
+    registry->insert(registry, name, geometry, true);
+
+    return geometry;
+}
+
+
+Geometry* acquireCube()
+{
+    return acquireGeometry(GEOMETRY_CUBE, CUBE_VERTICES,
+                           sizeof(CUBE_VERTICES) /
+                           (VERTEX_SIZE * sizeof(float)));
+}
+
+
+void setGeometryInstances(mat4* instances, int count)
+{
+    // Orphan the previous contents so the driver does not stall on a buffer
+    // that is still in use by the last frame
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(mat4), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(mat4), instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+// Every geometry goes at once, however many references are still held
+void deleteGeometries()
+{
+    Geometry* geometry;
+    HashEntry* iter;
+
+    if (! registry)
+        return;
+
+    HASHTABLE_FOR_EACH(registry, iter)
+    {
+        geometry = (Geometry*)iter->value;
+
+        glDeleteVertexArrays(1, &(geometry->VAO));
+        glDeleteBuffers(1, &(geometry->VBO));
+        glDeleteBuffers(1, &(geometry->EBO));
+    }
+
+    glBindVertexArray(0);
+    boundVAO = 0;
+
+    // Frees every geometry
+    registry->deleteHashTable(&registry);
+
+    glDeleteBuffers(1, &instanceVBO);
+    instanceVBO = 0;
+}
+
+
+static void linkMethods(Geometry* this)
+{
+    this->bind = bind;
+    this->setInstanceOffset = setInstanceOffset;
+    this->draw = draw;
+    this->release = release;
+}
+
+
+static bool setGlBuffers(Geometry* this, const float* vertices)
+{
+    PackedVertex* packed;
+    uint32_t* indices;
+    uint16_t* shortIndices;
+    size_t indexSize = sizeof(uint32_t);
+    void* indexData;
+
+    packed = (PackedVertex*)malloc(this->vertexCount * sizeof(PackedVertex));
+    indices = (uint32_t*)malloc(this->vertexCount * sizeof(uint32_t));
+
+    if (! packed || ! indices)
+    {
+        fprintf(stderr, ERR_GEOMETRY_MALLOC);
+        SAFE_FREE(packed);
+        SAFE_FREE(indices);
+        return false;
+    }
+
+    this->indexCount = this->vertexCount;
+    this->uniqueCount = packVertices(vertices, this->vertexCount, packed,
+                                     indices);
+    this->indexType = GL_UNSIGNED_INT;
+    indexData = indices;
+
+    // Narrow the indices in place when they fit, it halves the index buffer
+    // of everything but the largest baked batches
+    if (this->uniqueCount <= UINT16_MAX)
+    {
+        shortIndices = (uint16_t*)indices;
+
+        for (int i = 0; i < this->indexCount; i++)
+            shortIndices[i] = (uint16_t)indices[i];
+
+        this->indexType = GL_UNSIGNED_SHORT;
+        indexSize = sizeof(uint16_t);
+    }
+
+    this->bytes = this->uniqueCount * sizeof(PackedVertex) +
+                  this->indexCount * indexSize;
+
+    // Make VAO, VBO and EBO buffers, the element buffer is VAO state
+    glGenVertexArrays(1, &(this->VAO));
+    glGenBuffers(1, &(this->VBO));
+    glGenBuffers(1, &(this->EBO));
+
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glBufferData(GL_ARRAY_BUFFER, this->uniqueCount * sizeof(PackedVertex),
+                 packed, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indexCount * indexSize,
+                 indexData, GL_STATIC_DRAW);
+
+    SAFE_FREE(packed);
+    SAFE_FREE(indices);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void*)offsetof(PackedVertex, position));
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                          sizeof(PackedVertex),
+                          (void*)offsetof(PackedVertex, normal));
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void*)offsetof(PackedVertex, texCoord));
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    // Per-instance model matrix, shared by every geometry and filled by
+    // setGeometryInstances. A mat4 attribute takes up four vec4 locations
+    if (! instanceVBO)
+    {
+        // Start with one identity matrix so non-instanced draws never read
+        // from an empty buffer
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(mat4), GLM_MAT4_IDENTITY,
+                     GL_STREAM_DRAW);
+    }
+
+    setInstanceAttribs(0);
+
+    for (int i = 0; i < 4; i++)
+    {
+        glVertexAttribDivisor(INSTANCE_ATTRIB + i, 1);
+        glEnableVertexAttribArray(INSTANCE_ATTRIB + i);
+    }
+
+    glBindVertexArray(0);
+    boundVAO = 0;
+
+    return true;
+}
+
+
+// Packs every vertex and builds the index list, returns how many unique
+// vertices were written
+static int packVertices(const float* vertices, int count, PackedVertex* packed,
+                        uint32_t* indices)
+{
+    PackedVertex vertex;
+    int unique = 0;
+    int found;
+
+    for (int i = 0; i < count; i++)
+    {
+        packVertex(vertices + i * VERTEX_SIZE, &vertex);
+        found = -1;
+
+        // Only a short window back, enough for triangle lists of boxes
+        // without hashing every vertex of a large baked batch
+        for (int j = unique - 1; j >= MAX(unique - INDEX_WINDOW, 0); j--)
+        {
+            if (! memcmp(packed + j, &vertex, sizeof(PackedVertex)))
+            {
+                found = j;
+                break;
+            }
+        }
+
+        if (found < 0)
+        {
+            memcpy(packed + unique, &vertex, sizeof(PackedVertex));
+            found = unique++;
+        }
+
+        indices[i] = found;
+    }
+
+    return unique;
+}
+
+
+static void packVertex(const float* src, PackedVertex* dest)
+{
+    memset(dest, 0, sizeof(PackedVertex));
+
+    memcpy(dest->position, src, 3 * sizeof(float));
+    dest->normal = packNormal(src + 3);
+    dest->texCoord[0] = packHalf(src[6]);
+    dest->texCoord[1] = packHalf(src[7]);
+}
+
+
+static uint32_t packNormal(const float* normal)
+{
+    uint32_t packed = 0;
+    float value;
+
+    // Ten bits per component, x in the lowest
+    for (int i = 0; i < 3; i++)
+    {
+        value = MAX(MIN(normal[i], 1.0f), -1.0f);
+        packed |= ((uint32_t)(int32_t)lroundf(value * 511.0f) & 0x3FF) <<
+                  (10 * i);
+    }
+
+    return packed;
+}
+
+
+static uint16_t packHalf(float value)
+{
+    uint32_t bits;
+    uint32_t sign;
+    int32_t exponent;
+    uint32_t mantissa;
+
+    memcpy(&bits, &value, sizeof(float));
+
+    sign = (bits >> 16) & 0x8000;
+    exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    mantissa = bits & 0x7FFFFF;
+
+    // Texture coordinates never need subnormals, infinities or NaN, those
+    // flush to zero or saturate
+    if (exponent <= 0)
+        return (uint16_t)sign;
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7BFF);
+
+    // Round to nearest, a carry into the exponent is still correct
+    return (uint16_t)(sign + (((uint32_t)exponent << 10) | (mantissa >> 13)) +
+                      ((mantissa >> 12) & 1));
+}
+
+
+static void setBounds(Geometry* this, const float* vertices)
+{
+    glm_vec3_broadcast(FLT_MAX, this->bounds[0]);
+    glm_vec3_broadcast(-FLT_MAX, this->bounds[1]);
+
+    // Positions are the first three floats of every vertex
+    for (int i = 0; i < this->vertexCount; i++)
+    {
+        glm_vec3_minv(this->bounds[0], (float*)vertices + i * VERTEX_SIZE,
+                      this->bounds[0]);
+        glm_vec3_maxv(this->bounds[1], (float*)vertices + i * VERTEX_SIZE,
+                      this->bounds[1]);
+    }
+}
+
+
+static void bind(Geometry* this)
+{
+    // Every box shares the same few VAOs, skip the bind if already in effect
+    if (boundVAO != this->VAO)
+    {
+        glBindVertexArray(this->VAO);
+        boundVAO = this->VAO;
+    }
+}
+
+
+static void setInstanceOffset(Geometry* this, int offset)
+{
+    // Geometry has to be bound, attribute pointers are VAO state
+    setInstanceAttribs(offset);
+    this->instanceOffset = offset;
+}
+
+
+static void setInstanceAttribs(int offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+    for (int i = 0; i < 4; i++)
+        glVertexAttribPointer(INSTANCE_ATTRIB + i, 4, GL_FLOAT, GL_FALSE,
+                              sizeof(mat4),
+                              (void*)(offset * sizeof(mat4) + i * sizeof(vec4)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+static void draw(Geometry* this, int instances)
+{
+    if (instances > 0)
+        glDrawElementsInstanced(GL_TRIANGLES, this->indexCount,
+                                this->indexType, (void*)0, instances);
+    else
+        glDrawElements(GL_TRIANGLES, this->indexCount, this->indexType,
+                       (void*)0);
+}
+
+
+static void release(Geometry* this)
+{
+    if (--(this->refCount) > 0)
+        return;
+
+    if (boundVAO == this->VAO)
+    {
+        glBindVertexArray(0);
+        boundVAO = 0;
+    }
+
+    glDeleteVertexArrays(1, &(this->VAO));
+    glDeleteBuffers(1, &(this->VBO));
+    glDeleteBuffers(1, &(this->EBO));
+
+    // Frees this geometry
+    registry->delete(registry, this->name);
+
+    if (! registry->count)
+    {
+        registry->deleteHashTable(&registry);
+
+        glDeleteBuffers(1, &instanceVBO);
+        instanceVBO = 0;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <cglm/mat4.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ERR_GEOMETRY_MALLOC "Error: unable to allocate memory for geometry\n"
+
+#define GEOMETRY_NAME_SIZE 32
+#define GEOMETRY_CUBE "cube"
+
+// First vertex attribute location of the per-instance model matrix
+#define INSTANCE_ATTRIB 3
+
+// Floats per vertex, position, normal and texture coordinates
+#define VERTEX_SIZE 8
+
+// Unique vertices searched back for a duplicate when indexing, box faces
+// only ever repeat vertices of the same face
+#define INDEX_WINDOW 8
+
+
+// What is actually uploaded for each vertex, 20 bytes instead of 32.
+// Positions stay fp32 since baked geometry is in world space
+typedef struct PackedVertex
+{
+    float position[3];
+
+    // Signed normalised GL_INT_2_10_10_10_REV, w unused
+    uint32_t normal;
+
+    // Half floats
+    uint16_t texCoord[2];
+} PackedVertex;
+
+
+typedef struct Geometry
+{
+    char name[GEOMETRY_NAME_SIZE];
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;
+    int vertexCount;
+    int refCount;
+
+    // Draws go through the index buffer over the de-duplicated vertices
+    int indexCount;
+    int uniqueCount;
+    unsigned int indexType;
+
+    // Vertex and index data a single draw reads
+    size_t bytes;
+
+    // Interleaved position, normal and texture coordinates the buffer was
+    // made from, owned by whoever created the geometry
+    const float* vertices;
+
+    // Local space bounding box of every vertex
+    vec3 bounds[2];
+
+    // First instance matrix read by instanced draws
+    int instanceOffset;
+
+    void (*bind)(struct Geometry*);
+    void (*setInstanceOffset)(struct Geometry*, int);
+    void (*draw)(struct Geometry*, int);
+    void (*release)(struct Geometry*);
+} Geometry;
+
+
+Geometry* acquireGeometry(const char*, const float*, int);
+Geometry* acquireCube(void);
+void setGeometryInstances(mat4*, int);
+void deleteGeometries(void);
+
+#endif
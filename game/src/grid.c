@@ -0,0 +1,401 @@
+#include <cglm/vec3.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+
+#include "grid.h"
+
+
+// What a query keeps, a sphere or a box, and the box its cells cover
+typedef struct GridProbe
+{
+    vec3 min;
+    vec3 max;
+
+    vec3 point;
+    float radius;
+    bool sphere;
+} GridProbe;
+
+
+static void linkMethods(Grid*);
+
+static int add(Grid*, vec3, float, unsigned int);
+static void move(Grid*, int, vec3);
+static void removeEntity(Grid*, int);
+static int queryRadius(Grid*, vec3, float, unsigned int, int*, int);
+static int queryBox(Grid*, vec3, vec3, unsigned int, int*, int);
+static void resetStats(Grid*);
+static void destroy(Grid*);
+
+static int search(Grid*, GridProbe*, unsigned int, int*, int);
+static bool hits(Grid*, int, GridProbe*);
+static void cellRange(Grid*, vec3, vec3, ivec3, ivec3);
+static void insertCells(Grid*, int);
+static void removeCells(Grid*, int);
+static unsigned int hashCell(int, int, int);
+static bool resize(Grid*, int);
+
+
+Grid* newGrid(float cellSize)
+{
+    Grid* grid;
+
+    if (! (grid = (Grid*)malloc(sizeof(Grid))))
+    {
+        fprintf(stderr, ERR_GRID_MALLOC);
+        return NULL;
+    }
+
+    memset(grid, 0, sizeof(Grid));
+    linkMethods(grid);
+
+    grid->cellSize = cellSize;
+
+    if (! resize(grid, GRID_BASE_SIZE))
+    {
+        grid->destroy(grid);
+        SAFE_FREE(grid);
+        return NULL;
+    }
+
+    return grid;
+}
+
+
+static void linkMethods(Grid* this)
+{
+    this->add = add;
+    this->move = move;
+    this->remove = removeEntity;
+    this->queryRadius = queryRadius;
+    this->queryBox = queryBox;
+    this->resetStats = resetStats;
+    this->destroy = destroy;
+}
+
+
+static int add(Grid* this, vec3 center, float radius, unsigned int mask)
+{
+    int index;
+
+    if (this->freeCount)
+        index = this->free[--this->freeCount];
+    else
+    {
+        if (this->count == this->size && ! resize(this, this->size * 2))
+            return GRID_NONE;
+
+        index = this->count++;
+    }
+
+    glm_vec3_copy(center, this->center[index]);
+    this->radius[index] = radius;
+    this->mask[index] = mask;
+    this->used[index] = true;
+    this->stamp[index] = this->query;
+
+    insertCells(this, index);
+
+    return index;
+}
+
+
+static void move(Grid* this, int index, vec3 center)
+{
+    ivec3 min;
+    ivec3 max;
+    vec3 low;
+    vec3 high;
+
+    if (index < 0 || index >= this->count || ! this->used[index])
+        return;
+
+    glm_vec3_subs(center, this->radius[index], low);
+    glm_vec3_adds(center, this->radius[index], high);
+    cellRange(this, low, high, min, max);
+
+    glm_vec3_copy(center, this->center[index]);
+
+    // Most moves stay within the same cells and leave the buckets alone
+    if (! memcmp(min, this->cellMin[index], sizeof(ivec3)) &&
+        ! memcmp(max, this->cellMax[index], sizeof(ivec3)))
+        return;
+
+    removeCells(this, index);
+    insertCells(this, index);
+}
+
+
+static void removeEntity(Grid* this, int index)
+{
+    if (index < 0 || index >= this->count || ! this->used[index])
+        return;
+
+    removeCells(this, index);
+    this->used[index] = false;
+    this->free[this->freeCount++] = index;
+}
+
+
+static int queryRadius(Grid* this, vec3 point, float radius, unsigned int mask,
+                       int* results, int max)
+{
+    GridProbe probe;
+
+    glm_vec3_copy(point, probe.point);
+    probe.radius = radius;
+    probe.sphere = true;
+
+    glm_vec3_subs(point, radius, probe.min);
+    glm_vec3_adds(point, radius, probe.max);
+
+    return search(this, &probe, mask, results, max);
+}
+
+
+static int queryBox(Grid* this, vec3 min, vec3 max, unsigned int mask,
+                    int* results, int maxResults)
+{
+    GridProbe probe;
+
+    glm_vec3_copy(min, probe.min);
+    glm_vec3_copy(max, probe.max);
+    probe.sphere = false;
+
+    return search(this, &probe, mask, results, maxResults);
+}
+
+
+static void resetStats(Grid* this)
+{
+    memset(&(this->stats), 0, sizeof(GridStats));
+}
+
+
+static void destroy(Grid* this)
+{
+    for (int i = 0; i < GRID_BUCKETS; i++)
+        SAFE_FREE(this->buckets[i].items);
+
+    SAFE_FREE(this->center);
+    SAFE_FREE(this->radius);
+    SAFE_FREE(this->mask);
+    SAFE_FREE(this->used);
+    SAFE_FREE(this->cellMin);
+    SAFE_FREE(this->cellMax);
+    SAFE_FREE(this->stamp);
+    SAFE_FREE(this->free);
+}
+
+
+static int search(Grid* this, GridProbe* probe, unsigned int mask,
+                  int* results, int max)
+{
+    ivec3 low;
+    ivec3 high;
+    GridBucket* bucket;
+    long cells = 1;
+    int found = 0;
+    int index;
+
+    cellRange(this, probe->min, probe->max, low, high);
+
+    for (int i = 0; i < 3; i++)
+        cells *= high[i] - low[i] + 1;
+
+    // Every entity tested in this query is stamped with it
+    if (++this->query == 0)
+    {
+        memset(this->stamp, 0, this->size * sizeof(unsigned int));
+        this->query = 1;
+    }
+
+    this->stats.queries++;
+
+    // A query wider than the table looks through each bucket once instead
+    if (cells >= GRID_BUCKETS)
+    {
+        for (int b = 0; b < GRID_BUCKETS && found < max; b++)
+        {
+            bucket = this->buckets + b;
+            this->stats.cells++;
+
+            for (int i = 0; i < bucket->count && found < max; i++)
+                if (hits(this, index = bucket->items[i], probe) &&
+                    this->mask[index] & mask)
+                    results[found++] = index;
+        }
+
+        return found;
+    }
+
+    for (int x = low[0]; x <= high[0] && found < max; x++)
+        for (int y = low[1]; y <= high[1] && found < max; y++)
+            for (int z = low[2]; z <= high[2] && found < max; z++)
+            {
+                bucket = this->buckets + hashCell(x, y, z);
+                this->stats.cells++;
+
+                for (int i = 0; i < bucket->count && found < max; i++)
+                    if (hits(this, index = bucket->items[i], probe) &&
+                        this->mask[index] & mask)
+                        results[found++] = index;
+            }
+
+    return found;
+}
+
+
+static bool hits(Grid* this, int index, GridProbe* probe)
+{
+    float radius = this->radius[index];
+    float* center = this->center[index];
+
+    if (this->stamp[index] == this->query)
+        return false;
+
+    this->stamp[index] = this->query;
+    this->stats.tested++;
+
+    if (probe->sphere)
+        return glm_vec3_distance(probe->point, center) < probe->radius + radius;
+
+    for (int i = 0; i < 3; i++)
+        if (center[i] + radius < probe->min[i] ||
+            center[i] - radius > probe->max[i])
+            return false;
+
+    return true;
+}
+
+
+static void cellRange(Grid* this, vec3 min, vec3 max, ivec3 low, ivec3 high)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        low[i] = (int)floorf(min[i] / this->cellSize);
+        high[i] = (int)floorf(max[i] / this->cellSize);
+    }
+}
+
+
+static void insertCells(Grid* this, int index)
+{
+    GridBucket* bucket;
+    vec3 low;
+    vec3 high;
+    int* items;
+    bool listed;
+
+    glm_vec3_subs(this->center[index], this->radius[index], low);
+    glm_vec3_adds(this->center[index], this->radius[index], high);
+    cellRange(this, low, high, this->cellMin[index], this->cellMax[index]);
+
+    for (int x = this->cellMin[index][0]; x <= this->cellMax[index][0]; x++)
+        for (int y = this->cellMin[index][1]; y <= this->cellMax[index][1]; y++)
+            for (int z = this->cellMin[index][2]; z <= this->cellMax[index][2]; z++)
+            {
+                bucket = this->buckets + hashCell(x, y, z);
+
+                // Neighbouring cells may share a bucket, list it only once
+                listed = false;
+                for (int i = 0; i < bucket->count && ! listed; i++)
+                    listed = bucket->items[i] == index;
+
+                if (listed)
+                    continue;
+
+                if (bucket->count == bucket->size)
+                {
+                    if (! (items = (int*)realloc(bucket->items,
+                        MAX(bucket->size * 2, 4) * sizeof(int))))
+                    {
+                        fprintf(stderr, ERR_GRID_MALLOC);
+                        continue;
+                    }
+
+                    bucket->items = items;
+                    bucket->size = MAX(bucket->size * 2, 4);
+                }
+
+                bucket->items[bucket->count++] = index;
+            }
+}
+
+
+static void removeCells(Grid* this, int index)
+{
+    GridBucket* bucket;
+
+    for (int x = this->cellMin[index][0]; x <= this->cellMax[index][0]; x++)
+        for (int y = this->cellMin[index][1]; y <= this->cellMax[index][1]; y++)
+            for (int z = this->cellMin[index][2]; z <= this->cellMax[index][2]; z++)
+            {
+                bucket = this->buckets + hashCell(x, y, z);
+
+                // Order within a bucket does not matter, swap in the last
+                for (int i = 0; i < bucket->count; i++)
+                    if (bucket->items[i] == index)
+                    {
+                        bucket->items[i] = bucket->items[--bucket->count];
+                        break;
+                    }
+            }
+}
+
+
+static unsigned int hashCell(int x, int y, int z)
+{
+    return ((unsigned int)x * 73856093u ^
+            (unsigned int)y * 19349663u ^
+            (unsigned int)z * 83492791u) & (GRID_BUCKETS - 1);
+}
+
+
+static bool resize(Grid* this, int size)
+{
+    void* arrays[] = {
+        this->center, this->radius, this->mask, this->used,
+        this->cellMin, this->cellMax, this->stamp, this->free
+    };
+
+    size_t sizes[] = {
+        sizeof(vec3), sizeof(float), sizeof(unsigned int), sizeof(bool),
+        sizeof(ivec3), sizeof(ivec3), sizeof(unsigned int), sizeof(int)
+    };
+
+    int count = sizeof(arrays) / sizeof(arrays[0]);
+    bool ok = true;
+    void* temp;
+
+    for (int i = 0; i < count && ok; i++)
+    {
+        if (! (temp = realloc(arrays[i], size * sizes[i])))
+        {
+            fprintf(stderr, ERR_GRID_MALLOC);
+            ok = false;
+        }
+        else
+            arrays[i] = temp;
+    }
+
+    this->center = (vec3*)arrays[0];
+    this->radius = (float*)arrays[1];
+    this->mask = (unsigned int*)arrays[2];
+    this->used = (bool*)arrays[3];
+    this->cellMin = (ivec3*)arrays[4];
+    this->cellMax = (ivec3*)arrays[5];
+    this->stamp = (unsigned int*)arrays[6];
+    this->free = (int*)arrays[7];
+
+    if (ok)
+        this->size = size;
+
+    return ok;
+}
@@ -0,0 +1,80 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <cglm/vec3.h>
+
+#include <stdbool.h>
+
+#define ERR_GRID_MALLOC "Error: unable to allocate memory for spatial grid\n"
+
+#define GRID_BASE_SIZE 64
+
+// Cells hash into this many buckets, a power of two
+#define GRID_BUCKETS 4096
+
+#define GRID_NONE -1
+
+
+typedef struct GridStats
+{
+    unsigned int queries;
+    unsigned int cells;
+    unsigned int tested;
+} GridStats;
+
+
+// Entities sharing a bucket. Different cells may land in the same bucket, the
+// exact test at the end of every query sorts them out
+typedef struct GridBucket
+{
+    int* items;
+    int count;
+    int size;
+} GridBucket;
+
+
+// Uniform spatial hash of spheres. Every entity is listed in each cell its
+// bounding box overlaps, so a query only looks at the cells around it and
+// costs the same however many entities live elsewhere
+typedef struct Grid
+{
+    float cellSize;
+
+    int count;
+    int size;
+
+    vec3* center;
+    float* radius;
+    unsigned int* mask;
+    bool* used;
+
+    // Cells covered, inclusive, as of the last add or move
+    ivec3* cellMin;
+    ivec3* cellMax;
+
+    // Last query each entity was tested in, so one spanning several cells
+    // is only reported once
+    unsigned int* stamp;
+    unsigned int query;
+
+    // Slots of removed entities, reused before the arrays grow
+    int* free;
+    int freeCount;
+
+    GridBucket buckets[GRID_BUCKETS];
+
+    GridStats stats;
+
+    int (*add)(struct Grid*, vec3, float, unsigned int);
+    void (*move)(struct Grid*, int, vec3);
+    void (*remove)(struct Grid*, int);
+    int (*queryRadius)(struct Grid*, vec3, float, unsigned int, int*, int);
+    int (*queryBox)(struct Grid*, vec3, vec3, unsigned int, int*, int);
+    void (*resetStats)(struct Grid*);
+    void (*destroy)(struct Grid*);
+} Grid;
+
+
+Grid* newGrid(float);
+
+#endif
@@ -1,8 +1,3 @@
-// Hash Table adapted from:
-// https://github.com/jamesroutley/write-a-hash-table
-// Accessed 12/10/19
-
-#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,10 +7,9 @@
 
 #include "hashtable.h"
 
-static HashEntry DELETED = {NULL, NULL, false};
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
 
-static HashEntry* newHashEntry(const char*, void*, bool);
-static HashTable* newHashTableSized(const int);
 static void linkMethods(HashTable*);
 
 static bool valid(HashTable*, HashEntry*);
@@ -24,67 +18,34 @@ static void* search(HashTable*, const char*);
 static void delete(HashTable*, const char*);
 static void deleteShallow(HashTable*, const char*);
 
-static int hash(const char*, const int, const int);
-static void deleteHashEntry(HashEntry**);
-static void deleteHashEntryShallow(HashEntry**);
 static void deleteHashTable(HashTable**);
 static void deleteHashTableShallow(HashTable**);
 
-static void resize(HashTable*, const int);
-static int _hash(const char*, const int, const int);
-static int isPrime(const int);
-static int nextPrime(int);
+static unsigned int hash(const char*, int*);
+static int find(HashTable*, const char*, unsigned int);
+static void removeAt(HashTable*, int);
+static bool resize(HashTable*, const int);
 
 
-static HashEntry* newHashEntry(const char* key, void* value, bool isMalloc)
+HashTable* newHashTable()
 {
-    HashEntry* entry;
+    HashTable* table;
 
-    if (! (entry = (HashEntry*)malloc(sizeof(HashEntry))))
+    if (! (table = (HashTable*)malloc(sizeof(HashTable))))
     {
-        fprintf(stderr, ERR_HASHENTRY_MALLOC);
+        fprintf(stderr, ERR_HASHTABLE_MALLOC);
         return NULL;
     }
 
-    memset(entry, 0, sizeof(HashEntry));
+    memset(table, 0, sizeof(HashTable));
+    linkMethods(table);
 
-    if (! (entry->key = (char*)malloc(BUFSIZ * sizeof(char))))
+    if (! resize(table, HASHTABLE_BASE_SIZE))
     {
-        SAFE_FREE(entry);
+        SAFE_FREE(table);
         return NULL;
     }
 
-    strncpy(entry->key, key, BUFSIZ);
-    entry->value = value;
-    entry->isMalloc = isMalloc;
-
-    return entry;
-}
-
-
-HashTable* newHashTable()
-{
-    return newHashTableSized(BASE_SIZE);
-}
-
-
-static HashTable* newHashTableSized(const int baseSize)
-{
-    HashTable* table;
-
-    if (! (table = (HashTable*)malloc(sizeof(HashTable))))
-        fprintf(stderr, ERR_HASHTABLE_MALLOC);
-
-    table->baseSize = baseSize;
-    table->size = nextPrime(table->baseSize);
-    table->count = 0;
-
-    if (! (table->items = (HashEntry**)malloc(table->size * sizeof(HashEntry*))))
-        fprintf(stderr, ERR_HASHTABLE_MALLOC);
-
-    memset(table->items, 0, table->size * sizeof(HashEntry*));
-    linkMethods(table);
-
     return table;
 }
 
@@ -104,241 +65,195 @@ static void linkMethods(HashTable* this)
 
 static bool valid(HashTable* this, HashEntry* check)
 {
-    return check != NULL && check != &DELETED;
+    return check != NULL && check->used;
 }
 
 
 static void insert(HashTable* this, const char* key, void* value, bool isMalloc)
 {
     HashEntry* item;
-    HashEntry* current;
+    unsigned int keyHash;
+    int length;
     int index;
-    int i;
+    int mask;
 
-    if (((this->count * 100) / this->size) > 70)
-        resizeUp(this);
+    keyHash = hash(key, &length);
 
-    if (! (item = newHashEntry(key, value, isMalloc)))
+    if (length >= HASHTABLE_KEY_SIZE)
+    {
+        fprintf(stderr, ERR_HASHTABLE_KEY, key);
         return;
+    }
 
-    index = hash(item->key, this->size, 0);
-    current = this->items[index];
-    i = 0;
-
-    while (current != NULL)
+    // Replace the value of an existing key
+    if ((index = find(this, key, keyHash)) >= 0)
     {
-        if (current != &DELETED)
-        {
-            if (! strncmp(current->key, key, BUFSIZ))
-            {
-                deleteHashEntry(&current);
-                this->items[index] = item;
-                return;
-            }
-        }
+        item = this->items + index;
 
-        index = hash(item->key, this->size, i++);
-        current = this->items[index];
-    }
+        if (item->isMalloc && item->value != value)
+            SAFE_FREE(item->value);
 
-    this->items[index] = item;
-    this->count++;
-}
+        item->value = value;
+        item->isMalloc = isMalloc;
+        return;
+    }
 
+    if (((this->count + 1) * 100) / this->size > HASHTABLE_MAX_LOAD &&
+        ! resize(this, this->size << 1) && this->count + 1 >= this->size)
+        return;
 
-static void* search(HashTable* this, const char* key)
-{
-    int index = hash(key, this->size, 0);
-    HashEntry* item = this->items[index];
-    int i = 1;
+    mask = this->size - 1;
 
-    while (item != NULL)
-    {
-        if (item != &DELETED)
-            if (! strncmp(item->key, key, BUFSIZ))
-                return item->value;
+    for (index = keyHash & mask; this->items[index].used;
+         index = (index + 1) & mask);
 
-        index = hash(key, this->size, i++);
-        item = this->items[index];
-    }
+    item = this->items + index;
+    memcpy(item->key, key, length + 1);
+    item->value = value;
+    item->hash = keyHash;
+    item->used = true;
+    item->isMalloc = isMalloc;
 
-    return NULL;
+    this->count++;
 }
 
 
-static void delete(HashTable* this, const char* key)
+static void* search(HashTable* this, const char* key)
 {
-    int index = hash(key, this->size, 0);
-    HashEntry* item = this->items[index];
-    int i = 1;
-
-    // This produces memory errors :(
-    // Table will never downsize
-    /*
-    if (((this->count * 100) / this->size) < 10)
-        resizeDown(this);
-    */
-
-    while (item != NULL)
-    {
-        if (item != &DELETED && ! strncmp(item->key, key, BUFSIZ))
-        {
-            deleteHashEntry(&item);
-            this->items[index] = &DELETED;
-            this->count--;
-            return;
-        }
-
-        index = hash(key, this->size, i++);
-        item = this->items[index];
-    }
+    int length;
+    int index = find(this, key, hash(key, &length));
+    return index >= 0 ? this->items[index].value : NULL;
 }
 
 
-static void deleteShallow(HashTable* this, const char* key)
+static void delete(HashTable* this, const char* key)
 {
-    int index = hash(key, this->size, 0);
-    HashEntry* item = this->items[index];
-    int i = 1;
-
-    // This produces memory errors :(
-    // Table will never downsize
-    /*
-    if (((this->count * 100) / this->size) < 10)
-        resizeDown(this);
-    */
-
-    while (item != NULL)
-    {
-        if (item != &DELETED && ! strncmp(item->key, key, BUFSIZ))
-        {
-            deleteHashEntryShallow(&item);
-            this->items[index] = &DELETED;
-            this->count--;
-            return;
-        }
+    int length;
+    int index = find(this, key, hash(key, &length));
 
-        index = hash(key, this->size, i++);
-        item = this->items[index];
-    }
-}
+    if (index < 0)
+        return;
 
+    if (this->items[index].isMalloc)
+        SAFE_FREE(this->items[index].value);
 
-static int hash(const char* string, const int bucket, const int attempt)
-{
-    const int a = _hash(string, HASHTABLE_PRIME_1, bucket);
-    const int b = _hash(string, HASHTABLE_PRIME_2, bucket);
-    return (a + attempt * (! b ? 1 : b)) % bucket;
+    removeAt(this, index);
 }
 
 
-static void deleteHashEntry(HashEntry** entry)
+static void deleteShallow(HashTable* this, const char* key)
 {
-    if (*entry && *entry != &DELETED)
-    {
-        if ((*entry)->isMalloc)
-            SAFE_FREE((*entry)->value);
+    int length;
+    int index = find(this, key, hash(key, &length));
 
-        deleteHashEntryShallow(entry);
-    }
+    if (index >= 0)
+        removeAt(this, index);
 }
 
 
-static void deleteHashEntryShallow(HashEntry** entry)
+static void deleteHashTable(HashTable** table)
 {
-    if (*entry && *entry != &DELETED)
-    {
-        free((*entry)->key);
-        (*entry)->key = NULL;
+    for (int i = 0; i < (*table)->size; i++)
+        if ((*table)->items[i].used && (*table)->items[i].isMalloc)
+            SAFE_FREE((*table)->items[i].value);
 
-        free(*entry);
-        *entry = NULL;
-    }
+    deleteHashTableShallow(table);
 }
 
 
-static void deleteHashTable(HashTable** table)
+static void deleteHashTableShallow(HashTable** table)
 {
-    for (int i = 0; i < (*table)->size; i++)
-        deleteHashEntry((*table)->items + i);
-
     SAFE_FREE((*table)->items);
     SAFE_FREE(*table);
 }
 
 
-static void deleteHashTableShallow(HashTable** table)
+static unsigned int hash(const char* key, int* length)
 {
-    for (int i = 0; i < (*table)->size; i++)
-        deleteHashEntryShallow((*table)->items + i);
+    // FNV-1a, also measures the key on the way through
+    unsigned int value = FNV_OFFSET;
+    const char* c;
 
-    SAFE_FREE((*table)->items);
-    SAFE_FREE(*table);
+    for (c = key; *c; c++)
+    {
+        value ^= (unsigned char)*c;
+        value *= FNV_PRIME;
+    }
+
+    *length = c - key;
+    return value;
 }
 
 
-static void resize(HashTable* table, const int baseSize)
+static int find(HashTable* this, const char* key, unsigned int keyHash)
 {
-    if (baseSize < BASE_SIZE)
-        return;
+    int mask = this->size - 1;
 
-    HashTable* newTable = newHashTableSized(baseSize);
-    HashEntry* item;
+    // Load is capped below 100%, so every probe run ends at an empty slot
+    for (int i = keyHash & mask; this->items[i].used; i = (i + 1) & mask)
+        if (this->items[i].hash == keyHash && ! strcmp(this->items[i].key, key))
+            return i;
 
-    HashEntry** tempItems;
-    int temp;
+    return -1;
+}
 
-    HASHTABLE_FOR_EACH(table, item)
-        newTable->insert(newTable, item->key, item->value, item->isMalloc);
 
-    table->baseSize = newTable->baseSize;
-    table->count = newTable->count;
+static void removeAt(HashTable* this, int index)
+{
+    int mask = this->size - 1;
+    int next = index;
+    int home;
 
-    temp = table->size;
-    table->size = newTable->size;
-    newTable->size = temp;
+    this->items[index].used = false;
+    this->count--;
 
-    tempItems = table->items;
-    table->items = newTable->items;
-    newTable->items = tempItems;
+    // Pull later entries of the probe run back into the hole, unless that
+    // would move them before their home slot
+    while (this->items[next = (next + 1) & mask].used)
+    {
+        home = this->items[next].hash & mask;
 
-    newTable->deleteHashTableShallow(&newTable);
+        if (((next - home) & mask) >= ((next - index) & mask))
+        {
+            this->items[index] = this->items[next];
+            this->items[next].used = false;
+            index = next;
+        }
+    }
+
+    if (this->size > HASHTABLE_BASE_SIZE &&
+        (this->count * 100) / this->size < HASHTABLE_MIN_LOAD)
+        resize(this, this->size >> 1);
 }
 
 
-static int _hash(const char* string, const int prime, const int bucket)
+static bool resize(HashTable* this, const int size)
 {
-    long hash = 0;
-    const int length = strlen(string);
-    for (int i = 0; i < length; i++)
+    HashEntry* items;
+    int mask = size - 1;
+    int index;
+
+    if (! (items = (HashEntry*)calloc(size, sizeof(HashEntry))))
     {
-        hash += ((long)pow(prime, length - (i + 1)) * string[i]);
-        hash %= bucket;
+        fprintf(stderr, ERR_HASHTABLE_MALLOC);
+        return false;
     }
 
-    return (int)hash;
-}
+    // Hashes are kept with the entries, so nothing is rehashed here
+    for (int i = 0; i < this->size; i++)
+    {
+        if (! this->items[i].used)
+            continue;
 
+        for (index = this->items[i].hash & mask; items[index].used;
+             index = (index + 1) & mask);
 
-static int isPrime(const int x)
-{
-    if (x < 2)
-        return -1;
-    else if (x < 4)
-        return 1;
-    else if (! (x & 1))
-        return 0;
-
-    for (int i = 3; i <= floor(sqrt((double)x)); i += 2)
-        if (! (x % i))
-            return 0;
-
-    return 1;
-}
+        items[index] = this->items[i];
+    }
 
+    SAFE_FREE(this->items);
+    this->items = items;
+    this->size = size;
 
-static int nextPrime(int x)
-{
-    while (! isPrime(x++));
-    return x - 1;
+    return true;
 }
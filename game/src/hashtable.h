@@ -1,40 +1,45 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
 
+#include <stdbool.h>
 #include <stdio.h>
 
-#define HASHTABLE_PRIME_1 661
-#define HASHTABLE_PRIME_2 811
-#define BASE_SIZE 53
+// Size is always a power of two, resized to keep the load between the two
+// percentages below
+#define HASHTABLE_BASE_SIZE 64
+#define HASHTABLE_MAX_LOAD 70
+#define HASHTABLE_MIN_LOAD 10
 
-#define ERR_HASHENTRY_MALLOC "Error: unable to allocate memory for hash entry\n"
-#define ERR_HASHTABLE_MALLOC "Error: unable to allocate memory for hash table\n"
+// Keys are stored inline in the entry, including the terminator
+#define HASHTABLE_KEY_SIZE 64
 
-#define resizeUp(ht)    resize((ht), (ht)->size << 1)
-#define resizeDown(ht)  resize((ht), (ht)->size >> 1)
+#define ERR_HASHTABLE_MALLOC "Error: unable to allocate memory for hash table\n"
+#define ERR_HASHTABLE_KEY "Error: hash table key \"%s\" is too long\n"
 
-/* !!! DANGEROUS !!! */
+// Entries move when the table is modified, do not insert or delete while
+// iterating
 #define HASHTABLE_FOR_EACH(ht, iter) \
-    for (int i = ((iter) = (ht)->items[0], 0); \
-         i < (ht)->size; \
-         i += ((iter) = (ht)->items[i + 1], 1)) \
-        if ((ht)->valid((ht), (iter)))
+    for (int i = 0; i < (ht)->size; i++) \
+        if (((iter) = (ht)->items + i), (ht)->valid((ht), (iter)))
 
 
 typedef struct HashEntry
 {
-    char* key;
+    char key[HASHTABLE_KEY_SIZE];
     void* value;
+    unsigned int hash;
+    bool used;
     bool isMalloc;
 } HashEntry;
 
 
+// Open addressing with linear probing, deleted entries are filled by shifting
+// the rest of their probe run back, so there are no tombstones
 typedef struct HashTable
 {
-    int baseSize;
     int size;
     int count;
-    HashEntry** items;
+    HashEntry* items;
 
     bool (*valid)(struct HashTable*, struct HashEntry*);
 
@@ -3,10 +3,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "macros.h"
 
 #include "list.h"
 
+// Nodes and lists come and go often, keep them out of malloc
+static Pool* nodePool = NULL;
+static Pool* listPool = NULL;
+
 
 static void linkMethods(List*);
 
@@ -27,13 +32,13 @@ static ListNode* newNode(void* value, bool isMalloc)
 {
     ListNode* node;
 
-    if (! (node = (ListNode*)malloc(sizeof(ListNode))))
+    if (! (node = (ListNode*)poolAlloc(&nodePool, "list nodes",
+                                       sizeof(ListNode))))
     {
         fprintf(stderr, ERR_NODE_MALLOC);
         return NULL;
     }
 
-    memset(node, 0, sizeof(ListNode));
     node->next = NULL;
     node->prev = NULL;
     node->value = value;
@@ -47,13 +52,12 @@ List* newList()
 {
     List* list;
 
-    if (! (list = (List*)malloc(sizeof(List))))
+    if (! (list = (List*)poolAlloc(&listPool, "lists", sizeof(List))))
     {
         fprintf(stderr, ERR_LIST_MALLOC);
         return NULL;
     }
 
-    memset(list, 0, sizeof(List));
     list->head = NULL;
     list->tail = NULL;
     list->length = 0;
@@ -205,7 +209,8 @@ static void deleteList(List** this)
             SAFE_FREE(value);
     }
 
-    SAFE_FREE(*this);
+    poolRelease(&listPool, *this);
+    *this = NULL;
 }
 
 
@@ -217,7 +222,8 @@ static void deleteListShallow(List** this)
     while ((*this)->head)
         removeLast(*this, &value, &isMalloc);
 
-    SAFE_FREE(*this);
+    poolRelease(&listPool, *this);
+    *this = NULL;
 }
 
 
@@ -235,5 +241,6 @@ static void peek(ListNode* node, void** dest, bool* isMalloc)
 
 static void deleteNode(ListNode** node)
 {
-    SAFE_FREE(*node);
+    poolRelease(&nodePool, *node);
+    *node = NULL;
 }
@@ -0,0 +1,246 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stb_image.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "macros.h"
+#include "timer.h"
+
+#include "loader.h"
+
+
+static void linkMethods(Loader*);
+
+static bool getSize(Loader*, int, int*, int*);
+static bool next(Loader*, LoadedImage*);
+static void destroy(Loader*);
+
+static void* work(void*);
+static void runJob(Loader*, int);
+
+
+Loader* newLoader(char** filenames, int count, int channels, bool flip)
+{
+    Loader* loader;
+    int threads;
+
+    if (! (loader = (Loader*)malloc(sizeof(Loader))))
+    {
+        fprintf(stderr, ERR_LOADER_MALLOC);
+        return NULL;
+    }
+
+    memset(loader, 0, sizeof(Loader));
+    linkMethods(loader);
+
+    loader->count = count;
+    loader->channels = channels;
+    loader->start = getWallTime();
+
+    pthread_mutex_init(&(loader->lock), NULL);
+    pthread_cond_init(&(loader->changed), NULL);
+
+    loader->filenames = (char**)calloc(count, sizeof(char*));
+    loader->widths = (int*)calloc(count, sizeof(int));
+    loader->heights = (int*)calloc(count, sizeof(int));
+    loader->sized = (bool*)calloc(count, sizeof(bool));
+    loader->queue = (LoadedImage*)calloc(count, sizeof(LoadedImage));
+
+    if (! loader->filenames || ! loader->widths || ! loader->heights ||
+        ! loader->sized || ! loader->queue)
+    {
+        fprintf(stderr, ERR_LOADER_MALLOC);
+        loader->destroy(loader);
+        SAFE_FREE(loader);
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (! (loader->filenames[i] = (char*)malloc(strlen(filenames[i]) + 1)))
+        {
+            fprintf(stderr, ERR_LOADER_MALLOC);
+            loader->destroy(loader);
+            SAFE_FREE(loader);
+            return NULL;
+        }
+
+        strcpy(loader->filenames[i], filenames[i]);
+    }
+
+    // Global to stb_image, so set before any thread starts decoding. Its only
+    // other shared state is a lookup table filled with the same constants by
+    // whichever thread gets there first
+    stbi_set_flip_vertically_on_load(! flip);
+
+    // No more workers than cores, they would only take turns
+    threads = MIN(LOADER_THREADS, MAX(sysconf(_SC_NPROCESSORS_ONLN), 1));
+
+    for (int i = 0; i < threads; i++)
+    {
+        if (pthread_create(loader->threads + i, NULL, work, loader))
+        {
+            fprintf(stderr, ERR_LOADER_THREAD);
+            break;
+        }
+
+        loader->threadCount++;
+    }
+
+    return loader;
+}
+
+
+static void linkMethods(Loader* this)
+{
+    this->getSize = getSize;
+    this->next = next;
+    this->destroy = destroy;
+}
+
+
+static bool getSize(Loader* this, int index, int* width, int* height)
+{
+    // Without workers the size is read on demand
+    if (! this->threadCount && ! this->sized[index])
+        runJob(this, index);
+
+    pthread_mutex_lock(&(this->lock));
+
+    while (! this->sized[index])
+        pthread_cond_wait(&(this->changed), &(this->lock));
+
+    *width = this->widths[index];
+    *height = this->heights[index];
+
+    pthread_mutex_unlock(&(this->lock));
+
+    return *width > 0 && *height > 0;
+}
+
+
+static bool next(Loader* this, LoadedImage* image)
+{
+    double start = getWallTime();
+
+    pthread_mutex_lock(&(this->lock));
+
+    while (this->taken == this->queued && this->taken < this->count)
+    {
+        if (this->threadCount)
+            pthread_cond_wait(&(this->changed), &(this->lock));
+        else
+        {
+            // Decode in order on this thread instead
+            pthread_mutex_unlock(&(this->lock));
+            runJob(this, this->count + this->queued);
+            pthread_mutex_lock(&(this->lock));
+        }
+    }
+
+    if (this->threadCount)
+        this->stats.waitTime += getWallTime() - start;
+
+    if (this->taken == this->count)
+    {
+        pthread_mutex_unlock(&(this->lock));
+        return false;
+    }
+
+    memcpy(image, this->queue + this->taken++, sizeof(LoadedImage));
+    pthread_mutex_unlock(&(this->lock));
+
+    return true;
+}
+
+
+static void destroy(Loader* this)
+{
+    // Workers always run through every job, wait for them to finish
+    for (int i = 0; i < this->threadCount; i++)
+        pthread_join(this->threads[i], NULL);
+
+    for (int i = this->taken; i < this->queued; i++)
+        if (this->queue[i].data)
+            stbi_image_free(this->queue[i].data);
+
+    for (int i = 0; this->filenames && i < this->count; i++)
+        SAFE_FREE(this->filenames[i]);
+
+    SAFE_FREE(this->filenames);
+    SAFE_FREE(this->widths);
+    SAFE_FREE(this->heights);
+    SAFE_FREE(this->sized);
+    SAFE_FREE(this->queue);
+
+    pthread_mutex_destroy(&(this->lock));
+    pthread_cond_destroy(&(this->changed));
+}
+
+
+static void* work(void* pointer)
+{
+    Loader* this = (Loader*)pointer;
+    int job;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&(this->lock));
+        job = this->nextJob < 2 * this->count ? this->nextJob++ : -1;
+        pthread_mutex_unlock(&(this->lock));
+
+        if (job < 0)
+            return NULL;
+
+        runJob(this, job);
+    }
+}
+
+
+static void runJob(Loader* this, int job)
+{
+    // The first count jobs only read sizes, so the consumer can lay out its
+    // storage before any pixels arrive. The rest decode
+    LoadedImage image;
+    double start;
+    int channels;
+
+    memset(&image, 0, sizeof(LoadedImage));
+
+    if (job < this->count)
+    {
+        image.index = job;
+        stbi_info(this->filenames[job], &image.width, &image.height,
+                  &channels);
+
+        pthread_mutex_lock(&(this->lock));
+
+        this->widths[job] = image.width;
+        this->heights[job] = image.height;
+        this->sized[job] = true;
+
+        pthread_cond_broadcast(&(this->changed));
+        pthread_mutex_unlock(&(this->lock));
+        return;
+    }
+
+    image.index = job - this->count;
+    start = getWallTime();
+    image.data = stbi_load(this->filenames[image.index], &image.width,
+                           &image.height, &channels, this->channels);
+
+    pthread_mutex_lock(&(this->lock));
+
+    memcpy(this->queue + this->queued++, &image, sizeof(LoadedImage));
+    this->stats.decodeTime += getWallTime() - start;
+    this->stats.elapsed = getWallTime() - this->start;
+
+    pthread_cond_broadcast(&(this->changed));
+    pthread_mutex_unlock(&(this->lock));
+}
@@ -0,0 +1,77 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#define ERR_LOADER_MALLOC "Error: unable to allocate memory for image loader\n"
+#define ERR_LOADER_THREAD "Error: unable to start decode thread, decoding on the main thread\n"
+
+// Worker threads decoding images, 0 decodes everything on the calling thread
+// as it is asked for
+#ifndef LOADER_THREADS
+#define LOADER_THREADS 4
+#endif
+
+
+typedef struct LoadedImage
+{
+    int index;
+    int width;
+    int height;
+
+    // NULL if the image failed to load, freed by whoever takes it
+    unsigned char* data;
+} LoadedImage;
+
+
+typedef struct LoaderStats
+{
+    // Seconds from creation until the last image was decoded
+    double elapsed;
+
+    // Summed across every thread, so larger than elapsed when they overlap
+    double decodeTime;
+
+    // Time the consuming thread spent blocked on the workers
+    double waitTime;
+} LoaderStats;
+
+
+// Images are decoded in the background as soon as the loader is made, the
+// GL thread takes them off a queue in whatever order they finish
+typedef struct Loader
+{
+    char** filenames;
+    int count;
+    int channels;
+    double start;
+
+    pthread_t threads[LOADER_THREADS > 0 ? LOADER_THREADS : 1];
+    int threadCount;
+
+    // Everything below is guarded by lock. Workers first read every image's
+    // size, then decode, claiming jobs in order from nextJob
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int nextJob;
+
+    int* widths;
+    int* heights;
+    bool* sized;
+
+    LoadedImage* queue;
+    int queued;
+    int taken;
+
+    LoaderStats stats;
+
+    bool (*getSize)(struct Loader*, int, int*, int*);
+    bool (*next)(struct Loader*, LoadedImage*);
+    void (*destroy)(struct Loader*);
+} Loader;
+
+
+Loader* newLoader(char**, int, int, bool);
+
+#endif
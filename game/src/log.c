@@ -2,7 +2,13 @@
 #include <stdarg.h>
 
 #include "game.h"
+#include "arena.h"
+#include "box.h"
 #include "camera.h"
+#include "pacer.h"
+#include "renderer.h"
+#include "scene.h"
+#include "timer.h"
 
 #include "log.h"
 
@@ -19,6 +25,7 @@ void logInfo(FILE* f, Backend* engine)
     static int rows = 0;
 
     Camera* cam;
+    PoolStats pools;
 
     if (! engine)
         return;
@@ -27,7 +34,7 @@ void logInfo(FILE* f, Backend* engine)
     frameDelta++;
     frameCount++;
 
-    if ((glfwGetTime() - fpsLastTime) >= 1.0)
+    if ((getTime() - fpsLastTime) >= 1.0)
     {
         cacheFrameDelta = frameDelta;
         cacheFrameLatency = 1000.0 / (double)(cacheFrameDelta);
@@ -52,6 +59,31 @@ void logInfo(FILE* f, Backend* engine)
     _logInfo(f, &rows, LOG_CLEAR LOG_FRAME_COUNT "\n", frameCount);
     _logInfo(f, &rows, LOG_CLEAR LOG_FPS "\n", cacheFrameDelta);
     _logInfo(f, &rows, LOG_CLEAR LOG_FRAME_LATENCY "\n", cacheFrameLatency);
+    _logInfo(f, &rows, LOG_CLEAR LOG_UPDATE "\n", engine->updateTime * 1000.0,
+                                                  engine->updateSteps);
+
+    if (engine->pacer)
+        _logInfo(f, &rows, LOG_CLEAR LOG_PACING "\n",
+            getPaceModeName(engine->pacer->mode),
+            engine->pacer->jitter(engine->pacer, engine->pacer->mode) * 1000.0,
+            engine->pacer->latency * 1000.0);
+    _logInfo(f, &rows, LOG_CLEAR LOG_DRAW_CALLS "\n",
+        engine->renderer->stats.drawCalls,
+        engine->options[GAME_USE_INSTANCING] ? "Instanced" : "Immediate");
+    _logInfo(f, &rows, LOG_CLEAR LOG_STATE_CHANGES "\n",
+        engine->renderer->stats.stateChanges,
+        engine->renderer->stats.submitted);
+    _logInfo(f, &rows, LOG_CLEAR LOG_CULLING "\n",
+        engine->renderer->stats.visible,
+        engine->renderer->stats.culled);
+    _logInfo(f, &rows, LOG_CLEAR LOG_MATRICES "\n",
+        getBoxScene()->stats.recomputed,
+        getBoxScene()->stats.reused);
+
+    getPoolTotals(&pools);
+    _logInfo(f, &rows, LOG_CLEAR LOG_POOLS "\n", pools.live,
+        pools.allocations, pools.systemAllocations, pools.peakBytes);
+
     _logInfo(f, &rows, LOG_CLEAR LOG_CAM_LOCATION "\n", cam->position[0],
                                                         cam->position[1],
                                                         cam->position[2]);
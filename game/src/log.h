@@ -12,11 +12,25 @@
 #define LOG_FRAME_COUNT     "Frame count     : %lld"
 #define LOG_FPS             "Framerate       : %d fps"
 #define LOG_FRAME_LATENCY   "Latency         : %f ms"
+#define LOG_UPDATE          "Update          : %f ms (%d steps)"
+#define LOG_PACING          "Frame pacing    : %s, %f ms jitter, %f ms latency"
+#define LOG_DRAW_CALLS      "Draw calls      : %u (%s)"
+#define LOG_STATE_CHANGES   "State changes   : %u (%u submitted)"
+#define LOG_CULLING         "Frustum culling : %u visible, %u culled"
+#define LOG_MATRICES        "World matrices  : %u recomputed, %u reused"
+#define LOG_POOLS           "Pooled objects  : %d live, %lu allocations, %lu mallocs, %zu peak bytes"
 #define LOG_CAM_LOCATION    "Camera position : (%f, %f, %f)"
 #define LOG_CAM_FRONT       "Camera front    : (%f, %f, %f)"
 #define LOG_CAM_YAW         "Camera yaw      : %f"
 #define LOG_CAM_PITCH       "Camera pitch    : %f"
 
+#define LOG_STARTUP "Startup: %.2f ms, context %.2f ms, textures %.2f ms " \
+                    "(decode %.2f ms over %d threads, waited %.2f ms)\n"
+#define LOG_STARTUP_PACK "Startup: %.2f ms, context %.2f ms, textures %.2f ms " \
+                         "(mapped from %s)\n"
+#define LOG_STARTUP_SHADERS "Shaders: %.2f ms to start, %.2f ms to finish, " \
+                            "%d of %d programs cached, parallel compile %s\n"
+
 void logInfo(FILE*, Backend*);
 
 #endif
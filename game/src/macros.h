@@ -12,6 +12,7 @@
 #define RANGE_INC(a, b, c) ((a) >= (b) && (c) >= (a))
 #define MAX(a, b) ((a) >= (b) ? (a) : (b))
 #define MIN(a, b) ((a) >= (b) ? (b) : (a))
+#define CLAMP(x, lo, hi) MIN(MAX((x), (lo)), (hi))
 #define ASPECT_RATIO(w, h) ((float)(w) / (float)(h))
 #define KEY_PRESSED(window, key) glfwGetKey((window), (key)) == GLFW_PRESS
 
@@ -31,7 +32,7 @@
         (model)->addTexture((model), (text)[i]);                              \
                                                                               \
         if ((draw)[i])                                                        \
-            (model)->setupModelMatrix = (draw)[i];                            \
+            (model)->setMatrixCallback((model), (draw)[i]);                   \
         if ((root))                                                           \
             (root)->attach((root), (model));                                  \
         else                                                                  \
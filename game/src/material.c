@@ -4,28 +4,33 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+
 #include "material.h"
 
 
+static Pool* materialPool = NULL;
+
 static void linkMethods(Material*);
 
 static void setAmbient(Material*, vec3);
 static void setDiffuse(Material*, int);
 static void setSpecular(Material*, int);
 static void setShininess(Material*, float);
+static void deleteMaterial(Material**);
 
 
 Material* newMaterial()
 {
     Material* mat;
 
-    if (! (mat = (Material*)malloc(sizeof(Material))))
+    if (! (mat = (Material*)poolAlloc(&materialPool, "materials",
+                                      sizeof(Material))))
     {
         fprintf(stderr, ERR_MATERIAL_MALLOC);
         return NULL;
     }
 
-    memset(mat, 0, sizeof(Material));
     linkMethods(mat);
 
     return mat;
@@ -38,6 +43,7 @@ static void linkMethods(Material* this)
     this->setDiffuse = setDiffuse;
     this->setSpecular = setSpecular;
     this->setShininess = setShininess;
+    this->deleteMaterial = deleteMaterial;
 }
 
 
@@ -63,3 +69,10 @@ static void setShininess(Material* this, float shininess)
 {
     this->shininess = shininess;
 }
+
+
+static void deleteMaterial(Material** this)
+{
+    poolRelease(&materialPool, *this);
+    *this = NULL;
+}
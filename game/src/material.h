@@ -16,6 +16,7 @@ typedef struct Material
     void (*setDiffuse)(struct Material*, int);
     void (*setSpecular)(struct Material*, int);
     void (*setShininess)(struct Material*, float);
+    void (*deleteMaterial)(struct Material**);
 } Material;
 
 Material* newMaterial(void);
@@ -18,8 +18,7 @@ void initGround(Backend* engine, Material* defaultMaterial)
 {
     Box* root = NULL;
     Box* model = NULL;
-    HashTable* textures = engine->textures;
-    Texture* texture = (Texture*)textures->search(textures, "grass");
+    Texture* texture = engine->textureHandles[TEXTURE_GRASS];
 
     // Make a grid from (-50, -50) to (50, 50)
     for (int i = -50; i < 50; i += 10)
@@ -38,7 +37,7 @@ void initGround(Backend* engine, Material* defaultMaterial)
         }
     }
 
-    engine->models->insert(engine->models, "ground", root, true);
+    engine->models->insert(engine->models, "ground", root, false);
 }
 
 
@@ -46,9 +45,8 @@ void initTree(Backend* engine, Material* defaultMaterial)
 {
     Box* root;
     Box* model;
-    HashTable* textures = engine->textures;
 
-    Texture* texture = (Texture*)textures->search(textures, "tree_1");
+    Texture* texture = engine->textureHandles[TEXTURE_TREE_1];
 
     // Trunk
     root = newBox((vec3){0.0f, -1.5f, 0.0f});
@@ -65,14 +63,14 @@ void initTree(Backend* engine, Material* defaultMaterial)
     }
 
     // Leaves
-    texture = (Texture*)textures->search(textures, "tree_2");
+    texture = engine->textureHandles[TEXTURE_TREE_2];
     model = newBox((vec3){0.0f, 3.0f, 0.0f});
     model->setScale(model, (vec3){3.0f, 2.0f, 3.0f});
     memcpy(model->material, defaultMaterial, sizeof(Material));
     model->addTexture(model, texture);
 
     root->attach(root, model);
-    engine->models->insert(engine->models, "tree", root, true);
+    engine->models->insert(engine->models, "tree", root, false);
 }
 
 
@@ -80,10 +78,9 @@ void initWolf(Backend* engine, Material* defaultMaterial)
 {
     Box* root = NULL;
     Box* model = NULL;
-    HashTable* textures = engine->textures;
 
-    Texture* texture1 = (Texture*)textures->search(textures, "grey");
-    Texture* texture2 = (Texture*)textures->search(textures, "wolf_face");
+    Texture* texture1 = engine->textureHandles[TEXTURE_GREY];
+    Texture* texture2 = engine->textureHandles[TEXTURE_WOLF_FACE];
 
     vec3 specifications[][2] = {
         {{0.0f, 0.0f, 0.0f}, {0.5f,  0.5f,  1.0f}},  // Body
@@ -126,7 +123,7 @@ void initWolf(Backend* engine, Material* defaultMaterial)
     root->recordInitialPosition(root);
     root->recordInitialRotation(root);
 
-    engine->models->insert(engine->models, "wolf", root, true);
+    engine->models->insert(engine->models, "wolf", root, false);
 }
 
 
@@ -134,11 +131,10 @@ void initSheep(Backend* engine, Material* defaultMaterial)
 {
     Box* root = NULL;
     Box* model = NULL;
-    HashTable* textures = engine->textures;
 
-    Texture* texture1 = (Texture*)textures->search(textures, "black");
-    Texture* texture2 = (Texture*)textures->search(textures, "sheep_skin");
-    Texture* texture3 = (Texture*)textures->search(textures, "sheep_face");
+    Texture* texture1 = engine->textureHandles[TEXTURE_BLACK];
+    Texture* texture2 = engine->textureHandles[TEXTURE_SHEEP_SKIN];
+    Texture* texture3 = engine->textureHandles[TEXTURE_SHEEP_FACE];
 
     vec3 specifications[][2] = {
         {{0.0f, 0.0f, 0.0f},  {1.25f, 1.25f, 2.0f}}, // Body
@@ -190,7 +186,7 @@ void initSheep(Backend* engine, Material* defaultMaterial)
     root->recordInitialPosition(root);
     root->recordInitialRotation(root);
 
-    engine->models->insert(engine->models, "sheep", root, true);
+    engine->models->insert(engine->models, "sheep", root, false);
 }
 
 
@@ -198,8 +194,7 @@ void initTable(Backend* engine, Material* defaultMaterial, Material* shinyMateri
 {
     Box* root;
     Box* model;
-    HashTable* textures = engine->textures;
-    Texture* texture = (Texture*)textures->search(textures, "table");
+    Texture* texture = engine->textureHandles[TEXTURE_TABLE];
 
     // Table top
     root = newBox((vec3){0.0f, 0.0f, 0.0f});
@@ -212,7 +207,7 @@ void initTable(Backend* engine, Material* defaultMaterial, Material* shinyMateri
     {
         for (int j = -1; j < 2; j += 2)
         {
-            texture = (Texture*)textures->search(textures, "black");
+            texture = engine->textureHandles[TEXTURE_BLACK];
             model = newBox((vec3){-0.8f * (float)i, -0.675f, -0.8f * (float)j});
             model->setScale(model, (vec3){0.1f, 1.25f, 0.1f});
             memcpy(model->material, shinyMaterial, sizeof(Material));
@@ -226,7 +221,7 @@ void initTable(Backend* engine, Material* defaultMaterial, Material* shinyMateri
     root->recordInitialPosition(root);
     root->recordInitialRotation(root);
 
-    engine->models->insert(engine->models, "table", root, true);
+    engine->models->insert(engine->models, "table", root, false);
 }
 
 
@@ -234,11 +229,10 @@ void initTorch(Backend* engine, Material* defaultMaterial, Material* shinyMateri
 {
     Box* root = NULL;
     Box* model = NULL;
-    HashTable* textures = engine->textures;
 
-    Texture* texture1 = (Texture*)textures->search(textures, "black");
-    Texture* texture2 = (Texture*)textures->search(textures, "white");
-    Texture* texture3 = (Texture*)textures->search(textures, "red");
+    Texture* texture1 = engine->textureHandles[TEXTURE_BLACK];
+    Texture* texture2 = engine->textureHandles[TEXTURE_WHITE];
+    Texture* texture3 = engine->textureHandles[TEXTURE_RED];
 
     vec3 specifications[][2] = {
         {{0.0f, 0.0f, 0.0f},  {0.1f,   0.5f,  0.1f}},
@@ -256,7 +250,7 @@ void initTorch(Backend* engine, Material* defaultMaterial, Material* shinyMateri
     root->recordInitialPosition(root);
     root->recordInitialRotation(root);
 
-    engine->models->insert(engine->models, "torch", root, true);
+    engine->models->insert(engine->models, "torch", root, false);
 }
 
 
@@ -264,10 +258,9 @@ void initSign(Backend* engine, Material* defaultMaterial)
 {
     Box* root = NULL;
     Box* model = NULL;
-    HashTable* textures = engine->textures;
 
-    Texture* texture1 = (Texture*)textures->search(textures, "sign_1");
-    Texture* texture2 = (Texture*)textures->search(textures, "sign_2");
+    Texture* texture1 = engine->textureHandles[TEXTURE_SIGN_1];
+    Texture* texture2 = engine->textureHandles[TEXTURE_SIGN_2];
 
     vec3 specifications[][2] = {
         {{0.0f, 0.0f, 0.0f},   {0.1f,    1.5f,    0.1f}},
@@ -285,7 +278,7 @@ void initSign(Backend* engine, Material* defaultMaterial)
     root->recordInitialPosition(root);
     root->recordInitialRotation(root);
 
-    engine->models->insert(engine->models, "sign", root, true);
+    engine->models->insert(engine->models, "sign", root, false);
 }
 
 
@@ -293,9 +286,8 @@ void initTrap(Backend* engine, Material* shinyMaterial)
 {
     Box* root = NULL;
     Box* model = NULL;
-    HashTable* textures = engine->textures;
 
-    Texture* texture1 = (Texture*)textures->search(textures, "black");
+    Texture* texture1 = engine->textureHandles[TEXTURE_BLACK];
 
     vec3 specifications[][2] = {
         {{0.0f, 0.0f, 0.0f}, {1.0f, 0.05f, 1.0f}},  // Base
@@ -356,16 +348,15 @@ void initTrap(Backend* engine, Material* shinyMaterial)
 
     MAKE_MODEL(root, model, specifications, textureMap, materialMap, drawingFuncs);
 
-    engine->models->insert(engine->models, "trap", root, true);
+    engine->models->insert(engine->models, "trap", root, false);
 }
 
 
 void initSafeZone(Backend* engine, Material* shinyMaterial)
 {
     Box* root = NULL;
-    HashTable* textures = engine->textures;
 
-    Texture* texture1 = (Texture*)textures->search(textures, "safe_zone");
+    Texture* texture1 = engine->textureHandles[TEXTURE_SAFE_ZONE];
 
     root = newBox((vec3){0.0f, 0.0f, 0.0f});
     root->setScale(root, (vec3){1.0f, 0.05f, 1.0f});
@@ -378,7 +369,7 @@ void initSafeZone(Backend* engine, Material* shinyMaterial)
     root->recordInitialPosition(root);
     root->recordInitialRotation(root);
 
-    engine->models->insert(engine->models, "safe_zone", root, true);
+    engine->models->insert(engine->models, "safe_zone", root, false);
 }
 
 
@@ -392,5 +383,5 @@ void initGameMessage(Backend* engine, Material* defaultMaterial, const char* key
     memcpy(root->material, defaultMaterial, sizeof(Material));
     root->addTexture(root, texture1);
     root->setRotation(root, (vec3){90.0f, 0.0f, 0.0f});
-    engine->models->insert(engine->models, key, root, true);
+    engine->models->insert(engine->models, key, root, false);
 }
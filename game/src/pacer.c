@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <GLFW/glfw3.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "macros.h"
+#include "timer.h"
+
+#include "pacer.h"
+
+
+static const char* modeNames[] = {
+    "uncapped", "vsync", "target", "late"
+};
+
+
+static void linkMethods(Pacer*);
+
+static void setMode(Pacer*, PaceMode);
+static void cycleMode(Pacer*);
+static void latch(Pacer*);
+static void present(Pacer*);
+static double jitter(Pacer*, PaceMode);
+static void report(Pacer*, FILE*);
+static void destroy(Pacer*);
+
+static void poll(Pacer*);
+static void waitUntil(double);
+
+
+Pacer* newPacer(GLFWwindow* window, PaceMode mode, double fps)
+{
+    Pacer* pacer;
+
+    if (! (pacer = (Pacer*)malloc(sizeof(Pacer))))
+    {
+        fprintf(stderr, ERR_PACER_MALLOC);
+        return NULL;
+    }
+
+    memset(pacer, 0, sizeof(Pacer));
+    linkMethods(pacer);
+
+    pacer->window = window;
+    pacer->interval = 1.0 / (fps > 0.0 ? fps : PACE_FPS);
+    pacer->setMode(pacer, mode);
+
+    return pacer;
+}
+
+
+PaceMode findPaceMode(const char* name)
+{
+    for (int i = 0; i < PACE_MODE_COUNT; i++)
+        if (! strcmp(name, modeNames[i]))
+            return (PaceMode)i;
+
+    return PACE_MODE_COUNT;
+}
+
+
+const char* getPaceModeName(PaceMode mode)
+{
+    return mode < PACE_MODE_COUNT ? modeNames[mode] : "unknown";
+}
+
+
+static void linkMethods(Pacer* this)
+{
+    this->setMode = setMode;
+    this->cycleMode = cycleMode;
+    this->latch = latch;
+    this->present = present;
+    this->jitter = jitter;
+    this->report = report;
+    this->destroy = destroy;
+}
+
+
+static void setMode(Pacer* this, PaceMode mode)
+{
+    this->mode = mode;
+
+    // Every other mode paces itself, a swap waiting on the display as well
+    // would only add to the latency
+    glfwSwapInterval(mode == PACE_VSYNC ? 1 : 0);
+
+    // The frame spanning the switch belongs to neither mode
+    this->deadline = 0.0;
+    this->presented = 0.0;
+}
+
+
+static void cycleMode(Pacer* this)
+{
+    setMode(this, (PaceMode)((this->mode + 1) % PACE_MODE_COUNT));
+}
+
+
+static void latch(Pacer* this)
+{
+    if (this->mode != PACE_LATE_LATCH)
+        return;
+
+    // Time to spare goes before input is polled rather than after the frame
+    // is drawn, so the frame is built from input as fresh as it can be
+    if (this->deadline > 0.0)
+        waitUntil(this->deadline - this->build - PACE_LATCH_MARGIN);
+
+    poll(this);
+}
+
+
+static void present(Pacer* this)
+{
+    PaceStats* stats = this->stats + this->mode;
+    bool paced = this->mode == PACE_TARGET || this->mode == PACE_LATE_LATCH;
+    double now = getWallTime();
+
+    if (this->sampled > 0.0)
+        this->build = MAX(now - this->sampled, this->build * PACE_BUILD_DECAY);
+
+    if (paced)
+        waitUntil(this->deadline);
+
+    glfwSwapBuffers(this->window);
+    now = getWallTime();
+
+    // Keep to the cadence through small misses, start over after big ones
+    if (paced && (this->deadline += this->interval) < now)
+        this->deadline = now + this->interval;
+
+    this->latency = now - this->sampled;
+    this->frameTime = this->presented > 0.0 ? now - this->presented : 0.0;
+
+    if (this->presented > 0.0)
+    {
+        stats->frames++;
+        stats->frameSum += this->frameTime;
+        stats->frameSquares += this->frameTime * this->frameTime;
+        stats->frameWorst = MAX(stats->frameWorst, this->frameTime);
+        stats->latencySum += this->latency;
+        stats->latencyWorst = MAX(stats->latencyWorst, this->latency);
+    }
+
+    this->presented = now;
+
+    // Late latch polls at the start of the next frame instead
+    if (this->mode != PACE_LATE_LATCH)
+        poll(this);
+}
+
+
+// Standard deviation of frame times in seconds
+static double jitter(Pacer* this, PaceMode mode)
+{
+    PaceStats* stats = this->stats + mode;
+    double mean;
+
+    if (! stats->frames)
+        return 0.0;
+
+    mean = stats->frameSum / stats->frames;
+
+    return sqrt(MAX(stats->frameSquares / stats->frames - mean * mean, 0.0));
+}
+
+
+static void report(Pacer* this, FILE* f)
+{
+    PaceStats* stats;
+
+    for (int i = 0; i < PACE_MODE_COUNT; i++)
+    {
+        if (! (stats = this->stats + i)->frames)
+            continue;
+
+        fprintf(f, "Pacing: %-8s %lu frames, %.3f ms mean, %.3f ms jitter, "
+                   "%.3f ms worst, latency %.3f ms mean, %.3f ms worst\n",
+                modeNames[i], stats->frames,
+                stats->frameSum * 1000.0 / stats->frames,
+                jitter(this, (PaceMode)i) * 1000.0,
+                stats->frameWorst * 1000.0,
+                stats->latencySum * 1000.0 / stats->frames,
+                stats->latencyWorst * 1000.0);
+    }
+}
+
+
+static void destroy(Pacer* this)
+{
+}
+
+
+static void poll(Pacer* this)
+{
+    glfwPollEvents();
+    this->sampled = getWallTime();
+}
+
+
+static void waitUntil(double when)
+{
+    struct timespec time;
+    double remaining;
+
+    while ((remaining = when - getWallTime() - PACE_SPIN) > 0.0)
+    {
+        time.tv_sec = (time_t)remaining;
+        time.tv_nsec = (long)((remaining - time.tv_sec) * 1.0e9);
+        nanosleep(&time, NULL);
+    }
+
+    while (getWallTime() < when)
+        ;
+}
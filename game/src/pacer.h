@@ -0,0 +1,93 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <GLFW/glfw3.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define ERR_PACER_MALLOC "Error: unable to allocate memory for frame pacer\n"
+#define ERR_PACER_ARGS "Usage: game [--pacing uncapped|vsync|target|late] [--fps N]\n"
+
+#define PACE_FLAG "--pacing"
+#define PACE_FPS_FLAG "--fps"
+
+// Rate the target and late latch modes hold to without PACE_FPS_FLAG
+#define PACE_FPS 60.0
+
+// Waits are slept through up to this long before their deadline and spun
+// out from there, the scheduler may wake a millisecond or more late
+#define PACE_SPIN 0.002
+
+// Late latch wakes this long plus the slowest recent frame build before the
+// deadline, so the frame is ready in time
+#define PACE_LATCH_MARGIN 0.001
+
+// The slowest build remembered shrinks by this much a frame towards newer ones
+#define PACE_BUILD_DECAY 0.98
+
+
+typedef enum PaceMode
+{
+    PACE_UNCAPPED,
+    PACE_VSYNC,
+    PACE_TARGET,
+    PACE_LATE_LATCH,
+    PACE_MODE_COUNT
+} PaceMode;
+
+
+// Running totals for one mode. Frame time is between presents, latency from
+// input being polled to the frame built from it being presented
+typedef struct PaceStats
+{
+    unsigned long frames;
+    double frameSum;
+    double frameSquares;
+    double frameWorst;
+    double latencySum;
+    double latencyWorst;
+} PaceStats;
+
+
+// Decides when input is polled and frames are presented. Uncapped presents
+// as soon as a frame is ready, vsync leaves it to the swap interval, target
+// waits for a fixed cadence and late latch waits before polling instead of
+// after drawing, so less time passes between input and the screen
+typedef struct Pacer
+{
+    GLFWwindow* window;
+    PaceMode mode;
+    double interval;
+
+    // Wall clock times of the next present due, the last input poll and the
+    // last present
+    double deadline;
+    double sampled;
+    double presented;
+
+    // Slowest recent time from polling input to handing the frame over
+    double build;
+
+    // Last frame, in seconds
+    double frameTime;
+    double latency;
+
+    PaceStats stats[PACE_MODE_COUNT];
+
+    void (*setMode)(struct Pacer*, PaceMode);
+    void (*cycleMode)(struct Pacer*);
+    void (*latch)(struct Pacer*);
+    void (*present)(struct Pacer*);
+    double (*jitter)(struct Pacer*, PaceMode);
+    void (*report)(struct Pacer*, FILE*);
+    void (*destroy)(struct Pacer*);
+} Pacer;
+
+
+Pacer* newPacer(GLFWwindow*, PaceMode, double);
+
+// PACE_MODE_COUNT for names that are not a mode
+PaceMode findPaceMode(const char*);
+const char* getPaceModeName(PaceMode);
+
+#endif
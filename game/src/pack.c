@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "macros.h"
+
+#include "pack.h"
+
+
+static void linkMethods(Pack*);
+
+static const PackEntry* find(Pack*, const char*);
+static const void* getData(Pack*, const PackEntry*);
+static void destroy(Pack*);
+
+static bool validate(Pack*);
+static int compareEntries(const void*, const void*);
+
+
+// NULL without a message when the file does not exist, it is optional
+Pack* newPack(const char* filename)
+{
+    Pack* pack;
+    struct stat info;
+    int fd;
+
+    if ((fd = open(filename, O_RDONLY)) < 0)
+        return NULL;
+
+    if (! (pack = (Pack*)malloc(sizeof(Pack))))
+    {
+        fprintf(stderr, ERR_PACK_MALLOC);
+        close(fd);
+        return NULL;
+    }
+
+    memset(pack, 0, sizeof(Pack));
+    linkMethods(pack);
+    strncpy(pack->filename, filename, PACK_NAME_SIZE - 1);
+
+    if (! fstat(fd, &info) && info.st_size > 0)
+    {
+        pack->size = (size_t)info.st_size;
+        pack->map = mmap(NULL, pack->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (pack->map == MAP_FAILED)
+            pack->map = NULL;
+    }
+
+    // The mapping keeps the file alive
+    close(fd);
+
+    if (! pack->map || ! validate(pack))
+    {
+        fprintf(stderr, ERR_PACK_INVALID, filename);
+        pack->destroy(pack);
+        SAFE_FREE(pack);
+        return NULL;
+    }
+
+    // Everything in the pack is read during init, start paging it in now
+    posix_madvise(pack->map, pack->size, POSIX_MADV_WILLNEED);
+
+    return pack;
+}
+
+
+static void linkMethods(Pack* this)
+{
+    this->find = find;
+    this->getData = getData;
+    this->destroy = destroy;
+}
+
+
+static const PackEntry* find(Pack* this, const char* name)
+{
+    PackEntry key;
+
+    strncpy(key.name, name, PACK_NAME_SIZE - 1);
+    key.name[PACK_NAME_SIZE - 1] = '\0';
+
+    return (const PackEntry*)bsearch(&key, this->entries,
+                                     this->header->entryCount,
+                                     sizeof(PackEntry), compareEntries);
+}
+
+
+static const void* getData(Pack* this, const PackEntry* entry)
+{
+    return (const char*)this->map + entry->offset;
+}
+
+
+static void destroy(Pack* this)
+{
+    if (this->map)
+        munmap(this->map, this->size);
+
+    this->map = NULL;
+    this->header = NULL;
+    this->entries = NULL;
+}
+
+
+size_t packLevelSize(const PackEntry* entry, int level)
+{
+    return (size_t)MAX(entry->width >> level, 1) *
+           MAX(entry->height >> level, 1) * 4;
+}
+
+
+static bool validate(Pack* this)
+{
+    const PackEntry* entry;
+    size_t size;
+
+    this->header = (const PackHeader*)this->map;
+    this->entries = (const PackEntry*)(this->header + 1);
+
+    if (this->size < sizeof(PackHeader) ||
+        this->header->magic != PACK_MAGIC ||
+        this->header->version != PACK_VERSION ||
+        this->header->entryCount >
+            (this->size - sizeof(PackHeader)) / sizeof(PackEntry))
+        return false;
+
+    // Check every entry up front so lookups can trust what they find
+    for (unsigned int i = 0; i < this->header->entryCount; i++)
+    {
+        entry = this->entries + i;
+        size = 0;
+
+        if (entry->offset > this->size ||
+            entry->size > this->size - entry->offset ||
+            entry->name[PACK_NAME_SIZE - 1] != '\0' || entry->levels > 32)
+            return false;
+
+        // find relies on the packer's ordering
+        if (i > 0 && compareEntries(entry - 1, entry) >= 0)
+            return false;
+
+        if (entry->type == PACK_IMAGE)
+            for (unsigned int j = 0; j < entry->levels; j++)
+                size += packLevelSize(entry, j);
+
+        if (size > entry->size)
+            return false;
+    }
+
+    return true;
+}
+
+
+static int compareEntries(const void* a, const void* b)
+{
+    return strncmp(((PackEntry*)a)->name, ((PackEntry*)b)->name,
+                   PACK_NAME_SIZE);
+}
@@ -0,0 +1,73 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ERR_PACK_MALLOC "Error: unable to allocate memory for asset pack\n"
+#define ERR_PACK_INVALID "Error: asset pack \"%s\" is invalid, using loose files\n"
+
+#define PACK_MAGIC 0x4b415047
+#define PACK_VERSION 1
+#define PACK_NAME_SIZE 64
+
+// Every entry's data starts on this boundary within the file
+#define PACK_ALIGN 16
+
+
+// Written by the packer in native byte order. The file is the header, the
+// entries sorted by name, then each entry's data
+typedef struct PackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+} PackHeader;
+
+
+typedef enum
+{
+    // RGBA8, flipped for GL, every level of the mip chain one after another
+    PACK_IMAGE,
+
+    // Raw file contents, not null terminated
+    PACK_TEXT
+} PackEntryType;
+
+
+typedef struct PackEntry
+{
+    // Path the loose file would be loaded from, such as "shaders/shader.vs"
+    char name[PACK_NAME_SIZE];
+
+    uint32_t type;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+
+    uint64_t offset;
+    uint64_t size;
+} PackEntry;
+
+
+// The whole file is mapped read only, entry data is used in place
+typedef struct Pack
+{
+    char filename[PACK_NAME_SIZE];
+    void* map;
+    size_t size;
+
+    const PackHeader* header;
+    const PackEntry* entries;
+
+    const PackEntry* (*find)(struct Pack*, const char*);
+    const void* (*getData)(struct Pack*, const PackEntry*);
+    void (*destroy)(struct Pack*);
+} Pack;
+
+
+Pack* newPack(const char*);
+size_t packLevelSize(const PackEntry*, int);
+
+#endif
@@ -0,0 +1,470 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cglm/box.h>
+#include <cglm/frustum.h>
+#include <cglm/mat3.h>
+#include <cglm/mat4.h>
+#include <cglm/vec3.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "geometry.h"
+#include "macros.h"
+#include "material.h"
+#include "shader.h"
+#include "uniforms.h"
+
+#include "renderer.h"
+
+
+static void linkMethods(Renderer*);
+
+static void setShaderKey(Renderer*, int);
+static void setFrame(Renderer*, FrameUniforms*);
+static void setFrustum(Renderer*, mat4);
+static bool isVisible(Renderer*, vec3*, int);
+static void submit(Renderer*, RenderItem*);
+static int pushInstances(Renderer*, mat4*, int);
+static void flush(Renderer*);
+static void resetStats(Renderer*);
+static void destroy(Renderer*);
+
+static void resetState(Renderer*);
+static void applyState(Renderer*, RenderItem*);
+static void writeMaterials(Renderer*);
+static void normalMatrix(mat4, mat3);
+static bool sameMaterial(MaterialUniforms*, MaterialUniforms*);
+static int compareItems(const void*, const void*);
+
+
+Renderer* newRenderer()
+{
+    Renderer* renderer;
+
+    if (! (renderer = (Renderer*)malloc(sizeof(Renderer))))
+    {
+        fprintf(stderr, ERR_RENDERER_MALLOC);
+        return NULL;
+    }
+
+    memset(renderer, 0, sizeof(Renderer));
+    linkMethods(renderer);
+
+    renderer->size = RENDERER_BASE_SIZE;
+    renderer->instanceSize = RENDERER_BASE_SIZE;
+
+    renderer->items = (RenderItem*)malloc(renderer->size * sizeof(RenderItem));
+    renderer->instances = (mat4*)malloc(renderer->instanceSize * sizeof(mat4));
+
+    renderer->materialStride = uniformBlockStride(sizeof(MaterialUniforms));
+    renderer->frameBlock = newUniformBuffer(FRAME_BLOCK_BINDING,
+                                            sizeof(FrameUniforms));
+    renderer->materialBlock = newUniformBuffer(MATERIAL_BLOCK_BINDING,
+                                               RENDERER_BASE_SIZE *
+                                               renderer->materialStride);
+
+    if (! renderer->items || ! renderer->instances || ! renderer->frameBlock ||
+        ! renderer->materialBlock)
+    {
+        fprintf(stderr, ERR_RENDERER_MALLOC);
+        SAFE_FREE(renderer->items);
+        SAFE_FREE(renderer->instances);
+        SAFE_FREE(renderer->frameBlock);
+        SAFE_FREE(renderer->materialBlock);
+        SAFE_FREE(renderer);
+        return NULL;
+    }
+
+    return renderer;
+}
+
+
+static void linkMethods(Renderer* this)
+{
+    this->setShaderKey = setShaderKey;
+    this->setFrame = setFrame;
+    this->setFrustum = setFrustum;
+    this->isVisible = isVisible;
+    this->submit = submit;
+    this->pushInstances = pushInstances;
+    this->flush = flush;
+    this->resetStats = resetStats;
+    this->destroy = destroy;
+}
+
+
+static void setShaderKey(Renderer* this, int key)
+{
+    this->shaderKey = key;
+}
+
+
+static void setFrame(Renderer* this, FrameUniforms* frame)
+{
+    // Every program reads the same block, one upload covers all of them
+    this->frameBlock->update(this->frameBlock, frame, sizeof(FrameUniforms));
+}
+
+
+static void setFrustum(Renderer* this, mat4 viewProjection)
+{
+    // Works for both perspective and orthographic projections, the planes
+    // come straight out of the combined matrix
+    glm_frustum_planes(viewProjection, this->frustum);
+    this->culling = true;
+}
+
+
+static bool isVisible(Renderer* this, vec3* bounds, int boxes)
+{
+    // Bounds may cover a whole model, every box in it counts as culled.
+    // Visible boxes are counted as they are submitted
+    if (! this->culling || glm_aabb_frustum(bounds, this->frustum))
+        return true;
+
+    this->stats.culled += boxes;
+    return false;
+}
+
+
+static void submit(Renderer* this, RenderItem* item)
+{
+    RenderItem* items;
+
+    if (this->count == this->size)
+    {
+        if (! (items = (RenderItem*)realloc(this->items,
+                                            2 * this->size * sizeof(RenderItem))))
+        {
+            fprintf(stderr, ERR_RENDERER_MALLOC);
+            return;
+        }
+
+        this->items = items;
+        this->size *= 2;
+    }
+
+    memcpy(this->items + this->count, item, sizeof(RenderItem));
+    this->items[this->count].sequence = this->count;
+    this->count++;
+    this->stats.submitted++;
+    this->stats.visible += MAX(item->instanceCount, 1);
+}
+
+
+static int pushInstances(Renderer* this, mat4* instances, int count)
+{
+    mat4* temp;
+    int offset = this->instanceCount;
+    int size = this->instanceSize;
+
+    while (this->instanceCount + count > size)
+        size *= 2;
+
+    if (size != this->instanceSize)
+    {
+        if (! (temp = (mat4*)realloc(this->instances, size * sizeof(mat4))))
+        {
+            fprintf(stderr, ERR_RENDERER_MALLOC);
+            return -1;
+        }
+
+        this->instances = temp;
+        this->instanceSize = size;
+    }
+
+    memcpy(this->instances + offset, instances, count * sizeof(mat4));
+    this->instanceCount += count;
+
+    return offset;
+}
+
+
+static void flush(Renderer* this)
+{
+    RenderItem* item;
+    mat3 normal;
+
+    if (! this->count)
+        return;
+
+    // Upload every instance submitted this frame in one go, items then only
+    // move their attribute offset into this buffer
+    if (this->instanceCount)
+        setGeometryInstances(this->instances, this->instanceCount);
+
+    qsort(this->items, this->count, sizeof(RenderItem), compareItems);
+    writeMaterials(this);
+    resetState(this);
+
+    for (int i = 0; i < this->count; i++)
+    {
+        item = this->items + i;
+
+        applyState(this, item);
+
+        normalMatrix(item->model, normal);
+
+        item->shader->setMat4(item->shader, "model", item->model);
+        item->shader->setMat3(item->shader, "normalMatrix", normal);
+        item->geometry->draw(item->geometry, item->instanceCount);
+
+        this->stats.drawCalls++;
+        this->stats.vertices += item->geometry->indexCount *
+                                MAX(item->instanceCount, 1);
+        this->stats.vertexBytes += item->geometry->bytes *
+                                   MAX(item->instanceCount, 1);
+    }
+
+    // Non-instanced draws after this flush read the first instance, make sure
+    // every geometry points at the start of the buffer again
+    for (int i = 0; i < this->count; i++)
+    {
+        item = this->items + i;
+
+        if (item->geometry->instanceOffset)
+        {
+            item->geometry->bind(item->geometry);
+            item->geometry->setInstanceOffset(item->geometry, 0);
+        }
+    }
+
+    this->count = 0;
+    this->instanceCount = 0;
+}
+
+
+static void resetStats(Renderer* this)
+{
+    memset(&(this->stats), 0, sizeof(RenderStats));
+}
+
+
+static void destroy(Renderer* this)
+{
+    this->frameBlock->destroy(this->frameBlock);
+    this->materialBlock->destroy(this->materialBlock);
+
+    SAFE_FREE(this->items);
+    SAFE_FREE(this->instances);
+    SAFE_FREE(this->frameBlock);
+    SAFE_FREE(this->materialBlock);
+}
+
+
+static void resetState(Renderer* this)
+{
+    // Anything outside of the renderer may have touched GL state between
+    // flushes, so start each flush without assumptions
+    this->boundShader = NULL;
+    this->boundGeometry = NULL;
+    this->boundInstanced = false;
+    memset(this->boundTextures, 0, sizeof(this->boundTextures));
+    this->boundMaterialBlock = -1;
+    this->boundDiffuseUnit = -1;
+    this->boundSpecularUnit = -1;
+}
+
+
+static void applyState(Renderer* this, RenderItem* item)
+{
+    Shader* shader = item->shader;
+    bool instanced = item->instanceCount > 0;
+
+    if (this->boundShader != shader)
+    {
+        shader->setVariant(shader, this->shaderKey);
+        shader->use(shader);
+        this->boundShader = shader;
+        this->boundInstanced = false;
+        this->boundDiffuseUnit = -1;
+        this->boundSpecularUnit = -1;
+
+        shader->setBool(shader, "instanced", false);
+        this->stats.shaderChanges++;
+        this->stats.stateChanges++;
+    }
+
+    for (int i = 0; i < item->textureCount; i++)
+    {
+        if (this->boundTextures[i] != item->textures[i])
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, item->textures[i]);
+            this->boundTextures[i] = item->textures[i];
+
+            this->stats.textureChanges++;
+            this->stats.stateChanges++;
+        }
+    }
+
+    // Blocks are binding point state, they survive program changes
+    if (this->boundMaterialBlock != item->materialBlock)
+    {
+        this->materialBlock->bindRange(this->materialBlock,
+                                       item->materialBlock *
+                                       this->materialStride,
+                                       sizeof(MaterialUniforms));
+        this->boundMaterialBlock = item->materialBlock;
+
+        this->stats.materialChanges++;
+        this->stats.stateChanges++;
+    }
+
+    // Samplers are still plain uniforms of the program in use
+    if (this->boundDiffuseUnit != item->material->diffuse)
+    {
+        shader->setInt(shader, "diffuseMap", item->material->diffuse);
+        this->boundDiffuseUnit = item->material->diffuse;
+        this->stats.stateChanges++;
+    }
+
+    if (this->boundSpecularUnit != item->material->specular)
+    {
+        shader->setInt(shader, "specularMap", item->material->specular);
+        this->boundSpecularUnit = item->material->specular;
+        this->stats.stateChanges++;
+    }
+
+    if (this->boundGeometry != item->geometry)
+    {
+        item->geometry->bind(item->geometry);
+        this->boundGeometry = item->geometry;
+
+        this->stats.geometryChanges++;
+        this->stats.stateChanges++;
+    }
+
+    if (this->boundInstanced != instanced)
+    {
+        shader->setBool(shader, "instanced", instanced);
+        this->boundInstanced = instanced;
+        this->stats.stateChanges++;
+    }
+
+    if (instanced && item->geometry->instanceOffset != item->instanceOffset)
+    {
+        item->geometry->setInstanceOffset(item->geometry, item->instanceOffset);
+
+        this->stats.instanceChanges++;
+        this->stats.stateChanges++;
+    }
+}
+
+
+// Write one block per run of equal materials in the sorted items, so the
+// whole flush costs a single upload and a range bind per material change
+static void writeMaterials(Renderer* this)
+{
+    RenderItem* item;
+    MaterialUniforms material;
+    MaterialUniforms* previous = NULL;
+    unsigned char* mapped;
+    int count = 0;
+
+    if (! (mapped = (unsigned char*)this->materialBlock->map(
+               this->materialBlock, this->count * this->materialStride)))
+        return;
+
+    for (int i = 0; i < this->count; i++)
+    {
+        item = this->items + i;
+
+        // Layers only need the sampler the material actually reads from
+        memset(&material, 0, sizeof(MaterialUniforms));
+        material.shininess = item->material->shininess;
+        material.diffuseLayer =
+            item->layers[item->material->diffuse % MAX_ITEM_TEXTURES];
+        material.specularLayer =
+            item->layers[item->material->specular % MAX_ITEM_TEXTURES];
+
+        if (! previous || ! sameMaterial(previous, &material))
+        {
+            previous = (MaterialUniforms*)(mapped +
+                                           count * this->materialStride);
+            memcpy(previous, &material, sizeof(MaterialUniforms));
+            count++;
+        }
+
+        item->materialBlock = count - 1;
+    }
+
+    this->materialBlock->unmap(this->materialBlock);
+}
+
+
+// Inverse transpose of the model's upper 3x3, once per draw instead of once
+// per vertex. Rotations with a uniform scale are their own normal matrix up to
+// a scale the fragment shader normalises away, so those skip the inverse
+static void normalMatrix(mat4 model, mat3 dest)
+{
+    float lengths[3];
+    float epsilon;
+
+    glm_mat4_pick3(model, dest);
+
+    for (int i = 0; i < 3; i++)
+        lengths[i] = glm_vec3_norm2(dest[i]);
+
+    epsilon = 1e-4f * lengths[0];
+
+    if (fabsf(lengths[0] - lengths[1]) <= epsilon &&
+        fabsf(lengths[0] - lengths[2]) <= epsilon &&
+        fabsf(glm_vec3_dot(dest[0], dest[1])) <= epsilon &&
+        fabsf(glm_vec3_dot(dest[0], dest[2])) <= epsilon &&
+        fabsf(glm_vec3_dot(dest[1], dest[2])) <= epsilon)
+        return;
+
+    glm_mat3_inv(dest, dest);
+    glm_mat3_transpose(dest);
+}
+
+
+static bool sameMaterial(MaterialUniforms* a, MaterialUniforms* b)
+{
+    return a->shininess == b->shininess &&
+           a->diffuseLayer == b->diffuseLayer &&
+           a->specularLayer == b->specularLayer;
+}
+
+
+static int compareItems(const void* a, const void* b)
+{
+    const RenderItem* x = (const RenderItem*)a;
+    const RenderItem* y = (const RenderItem*)b;
+    int compare;
+
+    // Most expensive state first: program, textures, material, then buffers
+    if (x->shader != y->shader)
+        return x->shader->ID < y->shader->ID ? -1 : 1;
+
+    for (int i = 0; i < MAX_ITEM_TEXTURES; i++)
+        if (x->textures[i] != y->textures[i])
+            return x->textures[i] < y->textures[i] ? -1 : 1;
+
+    for (int i = 0; i < MAX_ITEM_TEXTURES; i++)
+        if (x->layers[i] != y->layers[i])
+            return x->layers[i] - y->layers[i];
+
+    if ((compare = memcmp(x->material->ambient, y->material->ambient,
+                          sizeof(vec3))))
+        return compare;
+    if (x->material->shininess != y->material->shininess)
+        return x->material->shininess < y->material->shininess ? -1 : 1;
+    if (x->material->diffuse != y->material->diffuse)
+        return x->material->diffuse - y->material->diffuse;
+    if (x->material->specular != y->material->specular)
+        return x->material->specular - y->material->specular;
+
+    if (x->geometry != y->geometry)
+        return x->geometry->VAO < y->geometry->VAO ? -1 : 1;
+    if (x->instanceOffset != y->instanceOffset)
+        return x->instanceOffset - y->instanceOffset;
+
+    return x->sequence - y->sequence;
+}
@@ -0,0 +1,118 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <cglm/mat4.h>
+#include <cglm/vec4.h>
+
+#include <stdbool.h>
+
+#include "geometry.h"
+#include "material.h"
+#include "shader.h"
+#include "uniforms.h"
+
+#define ERR_RENDERER_MALLOC "Error: unable to allocate memory for renderer\n"
+
+#define RENDERER_BASE_SIZE 256
+#define MAX_ITEM_TEXTURES 4
+
+
+typedef struct RenderItem
+{
+    Shader* shader;
+    Geometry* geometry;
+    Material* material;
+
+    // Texture arrays per unit, and the layer of each to sample
+    unsigned int textures[MAX_ITEM_TEXTURES];
+    int layers[MAX_ITEM_TEXTURES];
+    int textureCount;
+
+    mat4 model;
+
+    // Which of the flush's material blocks this item draws with
+    int materialBlock;
+
+    // Offset and count into the renderer's instance array, zero count for
+    // a regular draw
+    int instanceOffset;
+    int instanceCount;
+
+    // Submission order, used to keep sorting stable
+    int sequence;
+} RenderItem;
+
+
+typedef struct RenderStats
+{
+    unsigned int submitted;
+    unsigned int drawCalls;
+
+    unsigned int shaderChanges;
+    unsigned int textureChanges;
+    unsigned int materialChanges;
+    unsigned int geometryChanges;
+    unsigned int instanceChanges;
+    unsigned int stateChanges;
+
+    // Vertices drawn and the vertex and index bytes read to draw them
+    unsigned int vertices;
+    unsigned int vertexBytes;
+
+    // Box draws submitted and box draws rejected by the frustum test, an
+    // instanced draw counts once per instance
+    unsigned int visible;
+    unsigned int culled;
+} RenderStats;
+
+
+typedef struct Renderer
+{
+    RenderItem* items;
+    int count;
+    int size;
+
+    mat4* instances;
+    int instanceCount;
+    int instanceSize;
+
+    // Variant every shader is drawn with, see Shader's setVariant
+    int shaderKey;
+
+    // Camera and light shared by every program, and one material block per
+    // distinct material in a flush, each bound as a range
+    UniformBuffer* frameBlock;
+    UniformBuffer* materialBlock;
+    size_t materialStride;
+
+    // State currently in effect, only valid during a flush
+    Shader* boundShader;
+    Geometry* boundGeometry;
+    unsigned int boundTextures[MAX_ITEM_TEXTURES];
+    int boundMaterialBlock;
+    int boundDiffuseUnit;
+    int boundSpecularUnit;
+    bool boundInstanced;
+
+    // Planes of the current camera's view frustum, nothing is culled until
+    // one has been set
+    vec4 frustum[6];
+    bool culling;
+
+    RenderStats stats;
+
+    void (*setShaderKey)(struct Renderer*, int);
+    void (*setFrame)(struct Renderer*, FrameUniforms*);
+    void (*setFrustum)(struct Renderer*, mat4);
+    bool (*isVisible)(struct Renderer*, vec3*, int);
+    void (*submit)(struct Renderer*, RenderItem*);
+    int (*pushInstances)(struct Renderer*, mat4*, int);
+    void (*flush)(struct Renderer*);
+    void (*resetStats)(struct Renderer*);
+    void (*destroy)(struct Renderer*);
+} Renderer;
+
+
+Renderer* newRenderer(void);
+
+#endif
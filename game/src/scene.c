@@ -0,0 +1,449 @@
+#include <cglm/vec3.h>
+#include <cglm/mat4.h>
+#include <cglm/box.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "box.h"
+#include "macros.h"
+#include "transform.h"
+
+#include "scene.h"
+
+
+static void linkMethods(Scene*);
+
+static int add(Scene*, Box*);
+static void attach(Scene*, int, int);
+static void removeSubtree(Scene*, int);
+static void computeWorld(Scene*, int, int);
+static void resetStats(Scene*);
+static void destroy(Scene*);
+
+static void computeBounds(Scene*, int);
+static bool resize(Scene*, int);
+static bool reorder(Scene*, int*, int);
+static void repoint(Scene*, int);
+
+
+Scene* newScene()
+{
+    Scene* scene;
+
+    if (! (scene = (Scene*)malloc(sizeof(Scene))))
+    {
+        fprintf(stderr, ERR_SCENE_MALLOC);
+        return NULL;
+    }
+
+    memset(scene, 0, sizeof(Scene));
+    linkMethods(scene);
+
+    if (! resize(scene, SCENE_BASE_SIZE))
+    {
+        scene->destroy(scene);
+        SAFE_FREE(scene);
+        return NULL;
+    }
+
+    return scene;
+}
+
+
+static void linkMethods(Scene* this)
+{
+    this->add = add;
+    this->attach = attach;
+    this->remove = removeSubtree;
+    this->computeWorld = computeWorld;
+    this->resetStats = resetStats;
+    this->destroy = destroy;
+}
+
+
+static int add(Scene* this, Box* box)
+{
+    int index = this->count;
+
+    if (this->count == this->size && ! resize(this, this->size * 2))
+        return -1;
+
+    this->count++;
+
+    this->parent[index] = SCENE_ROOT;
+    this->subtreeSize[index] = 1;
+
+    glm_vec3_zero(this->position[index]);
+    glm_vec3_zero(this->rotation[index]);
+    glm_vec3_one(this->scale[index]);
+    glm_vec3_zero(this->modelPosition[index]);
+    glm_vec3_zero(this->initialPosition[index]);
+    glm_vec3_zero(this->initialRotation[index]);
+    glm_mat4_identity(this->world[index]);
+    this->dirty[index] = true;
+    this->animated[index] = false;
+
+    this->boxes[index] = box;
+    repoint(this, index);
+
+    return index;
+}
+
+
+static void attach(Scene* this, int parent, int child)
+{
+    Box* parentBox = this->boxes[parent];
+    Box* childBox = this->boxes[child];
+    Box* previous = NULL;
+    int* order;
+    int childSize = this->subtreeSize[child];
+    int parentSize = this->subtreeSize[parent];
+    int insert = 0;
+    int n = 0;
+
+    if (this->parent[child] != SCENE_ROOT)
+        previous = this->boxes[this->parent[child]];
+
+    // A child already somewhere under the parent ends up at the end of the
+    // parent's subtree without it
+    if (child > parent && child < parent + parentSize)
+        parentSize -= childSize;
+
+    // Move the child's subtree so it ends the parent's subtree, nothing to do
+    // in the usual case of attaching a box that was just made. Nothing is
+    // changed until the move has gone through
+    if (child != parent + parentSize)
+    {
+        if (! (order = (int*)malloc(this->count * sizeof(int))))
+        {
+            fprintf(stderr, ERR_SCENE_MALLOC);
+            return;
+        }
+
+        // Everything outside the child's subtree keeps its order
+        for (int i = 0; i < this->count; i++)
+        {
+            if (i >= child && i < child + childSize)
+                continue;
+
+            if (i == parent)
+                insert = n + parentSize;
+
+            order[n++] = i;
+        }
+
+        memmove(order + insert + childSize, order + insert,
+                (n - insert) * sizeof(int));
+
+        for (int i = 0; i < childSize; i++)
+            order[insert + i] = child + i;
+
+        if (! reorder(this, order, this->count))
+        {
+            SAFE_FREE(order);
+            return;
+        }
+
+        SAFE_FREE(order);
+    }
+
+    parent = parentBox->index;
+    child = childBox->index;
+
+    // Detach from the previous parent
+    for (int i = previous ? previous->index : SCENE_ROOT; i != SCENE_ROOT;
+         i = this->parent[i])
+    {
+        this->subtreeSize[i] -= childSize;
+        this->dirty[i] = true;
+    }
+
+    this->parent[child] = parent;
+
+    for (int i = parent; i != SCENE_ROOT; i = this->parent[i])
+        this->subtreeSize[i] += childSize;
+
+    // Subtree bounds changed, have them rebuilt on the next pass
+    this->dirty[parent] = true;
+}
+
+
+static void removeSubtree(Scene* this, int index)
+{
+    int* order;
+    int ancestor = this->parent[index];
+    int size = this->subtreeSize[index];
+    int n = 0;
+
+    if (! (order = (int*)malloc(this->count * sizeof(int))))
+    {
+        fprintf(stderr, ERR_SCENE_MALLOC);
+        return;
+    }
+
+    for (int i = 0; i < this->count; i++)
+        if (i < index || i >= index + size)
+            order[n++] = i;
+
+    if (! reorder(this, order, n))
+    {
+        SAFE_FREE(order);
+        return;
+    }
+
+    SAFE_FREE(order);
+
+    // Ancestors come before the subtree, so their indices are unchanged
+    for (int i = ancestor; i != SCENE_ROOT; i = this->parent[i])
+    {
+        this->subtreeSize[i] -= size;
+        this->dirty[i] = true;
+    }
+}
+
+
+static void computeWorld(Scene* this, int first, int count)
+{
+    int end = first + count;
+    unsigned int recomputed = this->stats.recomputed;
+    int run;
+
+    // Each box only depends on its own transform, so every run of dirty
+    // boxes goes through the batch kernel in one call
+    for (int i = first; i < end; i += run)
+    {
+        run = 1;
+
+        if (! this->dirty[i])
+        {
+            this->stats.reused++;
+            continue;
+        }
+
+        while (i + run < end && this->dirty[i + run])
+            run++;
+
+        transformBatch(this->position + i, this->rotation + i,
+                       this->modelPosition + i, this->scale + i,
+                       this->world + i, run);
+
+        for (int j = i; j < i + run; j++)
+            computeBounds(this, j);
+
+        memset(this->dirty + i, false, run * sizeof(bool));
+        this->stats.recomputed += run;
+    }
+
+    if (recomputed == this->stats.recomputed)
+        return;
+
+    // The range is a whole subtree, children come after their parents so
+    // walking it backwards folds every subtree into its root
+    for (int i = first; i < end; i++)
+        memcpy(this->subtreeBounds[i], this->bounds[i], sizeof(vec3[2]));
+
+    for (int i = end - 1; i > first; i--)
+        glm_aabb_merge(this->subtreeBounds[this->parent[i]],
+                       this->subtreeBounds[i],
+                       this->subtreeBounds[this->parent[i]]);
+}
+
+
+static void computeBounds(Scene* this, int index)
+{
+    vec3* local = this->boxes[index]->geometry->bounds;
+    vec3 extent;
+    float radius;
+
+    if (! this->animated[index])
+    {
+        glm_aabb_transform(local, this->world[index], this->bounds[index]);
+        return;
+    }
+
+    // Furthest any vertex can get from the box's position under rotation
+    glm_vec3_negate_to(local[0], extent);
+    glm_vec3_maxv(extent, local[1], extent);
+    glm_vec3_mul(extent, this->scale[index], extent);
+
+    radius = glm_vec3_norm(this->modelPosition[index]) + glm_vec3_norm(extent);
+
+    glm_vec3_subs(this->position[index], radius, this->bounds[index][0]);
+    glm_vec3_adds(this->position[index], radius, this->bounds[index][1]);
+}
+
+
+static void resetStats(Scene* this)
+{
+    memset(&(this->stats), 0, sizeof(SceneStats));
+}
+
+
+static void destroy(Scene* this)
+{
+    SAFE_FREE(this->parent);
+    SAFE_FREE(this->subtreeSize);
+    SAFE_FREE(this->position);
+    SAFE_FREE(this->rotation);
+    SAFE_FREE(this->scale);
+    SAFE_FREE(this->modelPosition);
+    SAFE_FREE(this->initialPosition);
+    SAFE_FREE(this->initialRotation);
+    SAFE_FREE(this->world);
+    SAFE_FREE(this->dirty);
+    SAFE_FREE(this->bounds);
+    SAFE_FREE(this->subtreeBounds);
+    SAFE_FREE(this->animated);
+    SAFE_FREE(this->boxes);
+}
+
+
+static bool resize(Scene* this, int size)
+{
+    void* arrays[] = {
+        this->parent, this->subtreeSize,
+        this->position, this->rotation, this->scale, this->modelPosition,
+        this->initialPosition, this->initialRotation,
+        this->world, this->dirty,
+        this->bounds, this->subtreeBounds, this->animated,
+        this->boxes
+    };
+
+    size_t sizes[] = {
+        sizeof(int), sizeof(int),
+        sizeof(vec3), sizeof(vec3), sizeof(vec3), sizeof(vec3),
+        sizeof(vec3), sizeof(vec3),
+        sizeof(mat4), sizeof(bool),
+        sizeof(vec3[2]), sizeof(vec3[2]), sizeof(bool),
+        sizeof(Box*)
+    };
+
+    int count = sizeof(arrays) / sizeof(arrays[0]);
+    bool ok = true;
+    void* temp;
+
+    for (int i = 0; i < count && ok; i++)
+    {
+        if (! (temp = realloc(arrays[i], size * sizes[i])))
+        {
+            fprintf(stderr, ERR_SCENE_MALLOC);
+            ok = false;
+        }
+        else
+            arrays[i] = temp;
+    }
+
+    // Arrays moved before a failure are written back too, the old pointers
+    // are already freed
+    this->parent = (int*)arrays[0];
+    this->subtreeSize = (int*)arrays[1];
+    this->position = (vec3*)arrays[2];
+    this->rotation = (vec3*)arrays[3];
+    this->scale = (vec3*)arrays[4];
+    this->modelPosition = (vec3*)arrays[5];
+    this->initialPosition = (vec3*)arrays[6];
+    this->initialRotation = (vec3*)arrays[7];
+    this->world = (mat4*)arrays[8];
+    this->dirty = (bool*)arrays[9];
+    this->bounds = (vec3(*)[2])arrays[10];
+    this->subtreeBounds = (vec3(*)[2])arrays[11];
+    this->animated = (bool*)arrays[12];
+    this->boxes = (Box**)arrays[13];
+
+    if (ok)
+        this->size = size;
+
+    // Storage may have moved, point every box back into it
+    for (int i = 0; i < this->count; i++)
+        repoint(this, i);
+
+    return ok;
+}
+
+
+static bool reorder(Scene* this, int* order, int count)
+{
+    // Rebuild every array so that new index i holds old index order[i]
+    Scene temp;
+    int* newIndex;
+
+    memset(&temp, 0, sizeof(Scene));
+
+    if (! resize(&temp, this->size) ||
+        ! (newIndex = (int*)malloc(this->count * sizeof(int))))
+    {
+        destroy(&temp);
+        return false;
+    }
+
+    for (int i = 0; i < this->count; i++)
+        newIndex[i] = SCENE_ROOT;
+
+    for (int i = 0; i < count; i++)
+        newIndex[order[i]] = i;
+
+    for (int i = 0; i < count; i++)
+    {
+        int old = order[i];
+
+        temp.parent[i] = this->parent[old] == SCENE_ROOT ?
+                         SCENE_ROOT : newIndex[this->parent[old]];
+        temp.subtreeSize[i] = this->subtreeSize[old];
+
+        glm_vec3_copy(this->position[old], temp.position[i]);
+        glm_vec3_copy(this->rotation[old], temp.rotation[i]);
+        glm_vec3_copy(this->scale[old], temp.scale[i]);
+        glm_vec3_copy(this->modelPosition[old], temp.modelPosition[i]);
+        glm_vec3_copy(this->initialPosition[old], temp.initialPosition[i]);
+        glm_vec3_copy(this->initialRotation[old], temp.initialRotation[i]);
+        glm_mat4_copy(this->world[old], temp.world[i]);
+        temp.dirty[i] = this->dirty[old];
+        memcpy(temp.bounds[i], this->bounds[old], sizeof(vec3[2]));
+        memcpy(temp.subtreeBounds[i], this->subtreeBounds[old],
+               sizeof(vec3[2]));
+        temp.animated[i] = this->animated[old];
+
+        temp.boxes[i] = this->boxes[old];
+    }
+
+    SAFE_FREE(newIndex);
+    destroy(this);
+
+    this->parent = temp.parent;
+    this->subtreeSize = temp.subtreeSize;
+    this->position = temp.position;
+    this->rotation = temp.rotation;
+    this->scale = temp.scale;
+    this->modelPosition = temp.modelPosition;
+    this->initialPosition = temp.initialPosition;
+    this->initialRotation = temp.initialRotation;
+    this->world = temp.world;
+    this->dirty = temp.dirty;
+    this->bounds = temp.bounds;
+    this->subtreeBounds = temp.subtreeBounds;
+    this->animated = temp.animated;
+    this->boxes = temp.boxes;
+    this->count = count;
+
+    for (int i = 0; i < this->count; i++)
+        repoint(this, i);
+
+    return true;
+}
+
+
+static void repoint(Scene* this, int index)
+{
+    Box* box = this->boxes[index];
+
+    box->index = index;
+    box->position = this->position[index];
+    box->rotation = this->rotation[index];
+    box->scale = this->scale[index];
+    box->modelPosition = this->modelPosition[index];
+    box->initialPosition = this->initialPosition[index];
+    box->initialRotation = this->initialRotation[index];
+}
@@ -0,0 +1,75 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cglm/vec3.h>
+#include <cglm/mat4.h>
+
+#include <stdbool.h>
+
+#define ERR_SCENE_MALLOC "Error: unable to allocate memory for scene\n"
+
+#define SCENE_BASE_SIZE 256
+
+#define SCENE_ROOT -1
+#define SCENE_END(scene, index) ((index) + (scene)->subtreeSize[(index)])
+
+struct Box;
+
+
+typedef struct SceneStats
+{
+    unsigned int recomputed;
+    unsigned int reused;
+} SceneStats;
+
+
+// Every box transform lives here in flat arrays. Boxes are kept in pre-order,
+// so a box's subtree is always the contiguous range
+// [index, index + subtreeSize[index])
+typedef struct Scene
+{
+    int count;
+    int size;
+
+    int* parent;
+    int* subtreeSize;
+
+    vec3* position;
+    vec3* rotation;
+    vec3* scale;
+    vec3* modelPosition;
+
+    vec3* initialPosition;
+    vec3* initialRotation;
+
+    // World matrices are only rebuilt for boxes whose transform changed
+    // since the last computeWorld
+    mat4* world;
+    bool* dirty;
+
+    // World space bounding boxes, refreshed along with the world matrices.
+    // subtreeBounds covers a box and everything attached to it
+    vec3 (*bounds)[2];
+    vec3 (*subtreeBounds)[2];
+
+    // Boxes drawn with their own model matrix callback, which may rotate
+    // them any way about their position, so their bounds cover every
+    // rotation
+    bool* animated;
+
+    struct Box** boxes;
+
+    SceneStats stats;
+
+    int (*add)(struct Scene*, struct Box*);
+    void (*attach)(struct Scene*, int, int);
+    void (*remove)(struct Scene*, int);
+    void (*computeWorld)(struct Scene*, int, int);
+    void (*resetStats)(struct Scene*);
+    void (*destroy)(struct Scene*);
+} Scene;
+
+
+Scene* newScene(void);
+
+#endif
@@ -4,32 +4,61 @@
 #include <cglm/vec3.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "macros.h"
+#include "pack.h"
 #include "shader.h"
+#include "shadercache.h"
+#include "uniforms.h"
+
+
+// Growable text the preprocessor writes into, always null terminated
+typedef struct SourceBuffer
+{
+    char* text;
+    int length;
+    int size;
+} SourceBuffer;
 
 
 static void linkMethods(Shader*);
 
+static int getUniformLocation(Shader*, const char*);
 static void use(Shader*);
+static void setVariant(Shader*, int);
+static void finish(Shader*);
 static void setBool(Shader*, const char*, bool);
 static void setInt(Shader*, const char*, int);
 static void setFloat(Shader*, const char*, float);
+static void setMat3(Shader*, const char*, mat3);
 static void setMat4(Shader*, const char*, mat4);
 static void setVec3(Shader*, const char*, vec3);
 
-static unsigned int compileShader(char*, int);
-static unsigned int linkProgram(unsigned int, unsigned int, char*);
+static void startProgram(Shader*, ShaderProgram*, Pack*, const char*, bool);
+static void finishProgram(Shader*, ShaderProgram*);
+static unsigned int compileShader(const char*, int, int);
+static unsigned int linkProgram(unsigned int, unsigned int, bool);
 static void checkCompile(unsigned int, int, char*);
-static char* fileRead(char*);
-
-Shader* newShader(char* vertexFilename, char* fragmentFilename)
+static bool linkStatus(unsigned int);
+static void cacheUniforms(ShaderProgram*, char*);
+static int compareUniforms(const void*, const void*);
+
+static bool preprocess(SourceBuffer*, Pack*, const char*, const char*, int);
+static bool append(SourceBuffer*, const char*, int);
+static bool isDirective(const char*, const char*, const char*);
+static bool includePath(const char*, const char*, const char*, char*);
+static const char* readSource(Pack*, const char*, int*, char**);
+static char* fileRead(const char*, int*);
+
+Shader* newShader(Pack* pack, char* vertexFilename, char* fragmentFilename,
+                  const char** defines, int variants)
 {
     Shader* shader;
-    unsigned int vertex;
-    unsigned int fragment;
+    bool binaries = programBinarySupported();
 
     if (! (shader = (Shader*)malloc(sizeof(Shader))))
     {
@@ -40,37 +69,114 @@ Shader* newShader(char* vertexFilename, char* fragmentFilename)
     memset(shader, 0, sizeof(Shader));
     linkMethods(shader);
 
-    vertex = compileShader(vertexFilename, GL_VERTEX_SHADER);
-    fragment = compileShader(fragmentFilename, GL_FRAGMENT_SHADER);
+    strncpy(shader->vertexFilename, vertexFilename, BUFSIZ - 1);
+    strncpy(shader->fragmentFilename, fragmentFilename, BUFSIZ - 1);
 
-    shader->ID = linkProgram(vertex, fragment, vertexFilename);
-    strncpy(shader->vertexFilename, vertexFilename, BUFSIZ);
-    strncpy(shader->fragmentFilename, fragmentFilename, BUFSIZ);
+    if (variants > MAX_SHADER_VARIANTS)
+    {
+        fprintf(stderr, ERR_SHADER_VARIANTS, vertexFilename);
+        variants = MAX_SHADER_VARIANTS;
+    }
+
+    // Every variant is handed to the driver before any is waited on, so
+    // drivers with parallel compilation work on them all at once
+    parallelShaderCompile();
+    shader->variantCount = MAX(variants, 1);
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    for (int i = 0; i < shader->variantCount; i++)
+        startProgram(shader, shader->programs + i, pack,
+                     defines && variants ? defines[i] : NULL, binaries);
+
+    setVariant(shader, 0);
 
     return shader;
 }
 
 
+bool parallelShaderCompile()
+{
+    // Let the driver use as many threads as it likes
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (GLAD_GL_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    else
+        return false;
+
+    return true;
+}
+
+
 static void linkMethods(Shader* this)
 {
+    this->getUniformLocation = getUniformLocation;
     this->use = use;
+    this->setVariant = setVariant;
+    this->finish = finish;
     this->setBool = setBool;
     this->setInt = setInt;
     this->setFloat = setFloat;
+    this->setMat3 = setMat3;
     this->setMat4 = setMat4;
     this->setVec3 = setVec3;
 }
 
 
+static int getUniformLocation(Shader* this, const char* name)
+{
+    ShaderProgram* program = this->programs + this->variant;
+    UniformCacheSlot* slot;
+    ShaderUniform key;
+
+    if (program->pending)
+        finishProgram(this, program);
+
+    slot = program->cache + (((uintptr_t)name >> 3) % UNIFORM_CACHE_SIZE);
+
+    // The address alone is not enough, a caller could reuse a buffer
+    if (slot->key == name && slot->uniform &&
+        ! strncmp(slot->uniform->name, name, UNIFORM_NAME_SIZE))
+        return slot->uniform->location;
+
+    strncpy(key.name, name, UNIFORM_NAME_SIZE - 1);
+    key.name[UNIFORM_NAME_SIZE - 1] = '\0';
+
+    slot->key = name;
+    slot->uniform = (ShaderUniform*)bsearch(&key, program->uniforms,
+                                            program->uniformCount,
+                                            sizeof(ShaderUniform),
+                                            compareUniforms);
+
+    return slot->uniform ? slot->uniform->location : -1;
+}
+
+
 static void use(Shader* this)
 {
+    if (this->programs[this->variant].pending)
+        finishProgram(this, this->programs + this->variant);
+
     glUseProgram(this->ID);
 }
 
 
+// Unknown keys fall back to the first variant, so shaders without variants
+// can be used under any key
+static void setVariant(Shader* this, int variant)
+{
+    this->variant = RANGE_INC(variant, 0, this->variantCount - 1) ? variant
+                                                                  : 0;
+    this->ID = this->programs[this->variant].ID;
+}
+
+
+static void finish(Shader* this)
+{
+    for (int i = 0; i < this->variantCount; i++)
+        finishProgram(this, this->programs + i);
+}
+
+
 static void setBool(Shader* this, const char* name, bool val)
 {
     glUniform1i(UNIFORM_LOC(this, name), (int)val);
@@ -89,6 +195,12 @@ static void setFloat(Shader* this, const char* name, float val)
 }
 
 
+static void setMat3(Shader* this, const char* name, mat3 mat)
+{
+    glUniformMatrix3fv(UNIFORM_LOC(this, name), 1, GL_FALSE, mat[0]);
+}
+
+
 static void setMat4(Shader* this, const char* name, mat4 mat)
 {
     glUniformMatrix4fv(UNIFORM_LOC(this, name), 1, GL_FALSE, mat[0]);
@@ -101,31 +213,99 @@ static void setVec3(Shader* this, const char* name, vec3 vec)
 }
 
 
-static unsigned int compileShader(char* filename, int type)
+static void startProgram(Shader* this, ShaderProgram* program, Pack* pack,
+                         const char* defines, bool binaries)
+{
+    SourceBuffer buffers[2];
+    const char* sources[2];
+    int lengths[2];
+
+    memset(buffers, 0, sizeof(buffers));
+
+    preprocess(buffers, pack, this->vertexFilename, defines, 0);
+    preprocess(buffers + 1, pack, this->fragmentFilename, defines, 0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        sources[i] = buffers[i].text ? buffers[i].text : "";
+        lengths[i] = buffers[i].length;
+    }
+
+    // A linked binary from an earlier run skips compiling altogether
+    if (binaries)
+    {
+        program->key = hashProgram(sources, lengths, 2, defines);
+
+        if ((program->ID = loadProgramBinary(program->key)))
+        {
+            program->cached = true;
+            bindUniformBlocks(program->ID);
+            cacheUniforms(program, this->vertexFilename);
+        }
+    }
+
+    if (! program->ID)
+    {
+        program->stages[0] = compileShader(sources[0], lengths[0],
+                                           GL_VERTEX_SHADER);
+        program->stages[1] = compileShader(sources[1], lengths[1],
+                                           GL_FRAGMENT_SHADER);
+        program->ID = linkProgram(program->stages[0], program->stages[1],
+                                  binaries);
+        program->pending = true;
+    }
+
+    SAFE_FREE(buffers[0].text);
+    SAFE_FREE(buffers[1].text);
+}
+
+
+// Blocks on the driver if it is still compiling, so only called once the
+// program is actually needed
+static void finishProgram(Shader* this, ShaderProgram* program)
+{
+    if (! program->pending)
+        return;
+
+    checkCompile(program->stages[0], SHADER, this->vertexFilename);
+    checkCompile(program->stages[1], SHADER, this->fragmentFilename);
+    checkCompile(program->ID, PROGRAM, this->vertexFilename);
+
+    glDeleteShader(program->stages[0]);
+    glDeleteShader(program->stages[1]);
+
+    if (program->key && linkStatus(program->ID))
+        saveProgramBinary(program->ID, program->key);
+
+    bindUniformBlocks(program->ID);
+    cacheUniforms(program, this->vertexFilename);
+    program->pending = false;
+}
+
+
+static unsigned int compileShader(const char* source, int length, int type)
 {
-    const char* source = fileRead(filename);
     unsigned int shader = glCreateShader(type);
 
-    glShaderSource(shader, 1, &source, NULL);
+    // The length lets sources be used without a terminator
+    glShaderSource(shader, 1, &source, &length);
     glCompileShader(shader);
-    checkCompile(shader, SHADER, filename);
-
-    free((char*)source);
-    source = NULL;
 
     return shader;
 }
 
 
 static unsigned int linkProgram(unsigned int vertex, unsigned int fragment,
-                                char* filename)
+                                bool retrievable)
 {
     unsigned int ID = glCreateProgram();
 
+    if (retrievable)
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
     glLinkProgram(ID);
-    checkCompile(ID, PROGRAM, filename);
 
     return ID;
 }
@@ -161,29 +341,224 @@ static void checkCompile(unsigned int shader, int type, char* name)
     }
 }
 
-static char* fileRead(char* filename)
+
+static bool linkStatus(unsigned int ID)
 {
-    char* file = NULL;
+    int success = 0;
+
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+
+    return success;
+}
+
+
+static void cacheUniforms(ShaderProgram* this, char* name)
+{
+    ShaderUniform* uniform;
+    char* bracket;
     int count = 0;
-    int i = -1;
-    int ch;
+    int length;
+    int size;
+    GLenum type;
 
-    FILE *fp;
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
 
-    if ((fp = fopen(filename, "r")))
+    if (count > MAX_UNIFORMS)
     {
-        while ((ch = fgetc(fp)) != EOF && ! ferror(fp))
-            count++;
+        fprintf(stderr, ERR_UNIFORM_COUNT, name);
+        count = MAX_UNIFORMS;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        uniform = this->uniforms + this->uniformCount;
+        glGetActiveUniform(this->ID, i, UNIFORM_NAME_SIZE, &length, &size,
+                           &type, uniform->name);
+
+        // Arrays are reported as "name[0]", look them up by the bare name
+        if ((bracket = strchr(uniform->name, '[')))
+            *bracket = '\0';
+
+        uniform->location = glGetUniformLocation(this->ID, uniform->name);
+
+        if (uniform->location != -1)
+            this->uniformCount++;
+    }
+
+    qsort(this->uniforms, this->uniformCount, sizeof(ShaderUniform),
+          compareUniforms);
+}
+
+
+static int compareUniforms(const void* a, const void* b)
+{
+    return strncmp(((ShaderUniform*)a)->name, ((ShaderUniform*)b)->name,
+                   UNIFORM_NAME_SIZE);
+}
 
-        fseek(fp, 0, SEEK_SET);
-        file = (char*)malloc((count + 1) * sizeof(char));
-        memset(file, 0, count + 1);
 
-        while ((ch = fgetc(fp)) != EOF && ! ferror(fp))
-            file[++i] = ch;
+// Resolves #include "file" relative to the including file and injects the
+// defines straight after #version. #line keeps error messages pointing at
+// the right line of the original file
+static bool preprocess(SourceBuffer* buffer, Pack* pack, const char* filename,
+                       const char* defines, int depth)
+{
+    char path[BUFSIZ];
+    char directive[32];
+    const char* source;
+    const char* line;
+    const char* next;
+    const char* end;
+    char* owned = NULL;
+    int length;
+    int number = 1;
+    bool ok = true;
+
+    if (! (source = readSource(pack, filename, &length, &owned)))
+        return false;
+
+    end = source + length;
+
+    for (line = source; line < end && ok; line = next, number++)
+    {
+        next = (next = memchr(line, '\n', end - line)) ? next + 1 : end;
+
+        if (isDirective(line, next, "#include"))
+        {
+            if (depth >= MAX_INCLUDE_DEPTH ||
+                ! includePath(line, next, filename, path))
+            {
+                fprintf(stderr, ERR_SHADER_INCLUDE, filename);
+                ok = false;
+                break;
+            }
+
+            snprintf(directive, sizeof(directive), "\n#line %d\n", number + 1);
+
+            ok = preprocess(buffer, pack, path, NULL, depth + 1) &&
+                 append(buffer, directive, strlen(directive));
+            continue;
+        }
+
+        ok = append(buffer, line, next - line);
+
+        if (ok && defines && isDirective(line, next, "#version"))
+        {
+            snprintf(directive, sizeof(directive), "\n#line %d\n", number + 1);
+
+            ok = (next[-1] == '\n' || append(buffer, "\n", 1)) &&
+                 append(buffer, defines, strlen(defines)) &&
+                 append(buffer, directive, strlen(directive));
+        }
+    }
+
+    SAFE_FREE(owned);
+
+    return ok;
+}
+
+
+static bool append(SourceBuffer* this, const char* text, int length)
+{
+    char* temp;
+    int size = MAX(this->size, BUFSIZ);
+
+    while (this->length + length + 1 > size)
+        size *= 2;
+
+    if (size != this->size)
+    {
+        if (! (temp = (char*)realloc(this->text, size)))
+        {
+            fprintf(stderr, ERR_SHADER_MALLOC);
+            return false;
+        }
+
+        this->text = temp;
+        this->size = size;
+    }
+
+    memcpy(this->text + this->length, text, length);
+    this->length += length;
+    this->text[this->length] = '\0';
+
+    return true;
+}
+
+
+static bool isDirective(const char* line, const char* end,
+                        const char* directive)
+{
+    int length = strlen(directive);
+
+    while (line < end && (*line == ' ' || *line == '\t'))
+        line++;
+
+    return end - line >= length && ! strncmp(line, directive, length);
+}
+
+
+static bool includePath(const char* line, const char* end,
+                        const char* filename, char* path)
+{
+    const char* open = memchr(line, '"', end - line);
+    const char* close = open ? memchr(open + 1, '"', end - open - 1) : NULL;
+    const char* slash = strrchr(filename, '/');
+    int directory = slash ? slash - filename + 1 : 0;
+
+    if (! close || close == open + 1 ||
+        directory + (close - open) >= BUFSIZ)
+        return false;
+
+    memcpy(path, filename, directory);
+    memcpy(path + directory, open + 1, close - open - 1);
+    path[directory + (close - open - 1)] = '\0';
+
+    return true;
+}
+
+
+// Straight out of the pack when it has the file, *owned is set to anything
+// the caller has to free
+static const char* readSource(Pack* pack, const char* filename, int* length,
+                              char** owned)
+{
+    const PackEntry* entry;
+
+    if (pack && (entry = pack->find(pack, filename)) &&
+        entry->type == PACK_TEXT)
+    {
+        *length = (int)entry->size;
+        return (const char*)pack->getData(pack, entry);
+    }
+
+    return (*owned = fileRead(filename, length));
+}
+
+
+static char* fileRead(const char* filename, int* length)
+{
+    char* file = NULL;
+    long size;
+
+    FILE *fp;
+
+    *length = 0;
+
+    if ((fp = fopen(filename, "rb")))
+    {
+        if (! fseek(fp, 0, SEEK_END) && (size = ftell(fp)) >= 0 &&
+            ! fseek(fp, 0, SEEK_SET) && (file = (char*)malloc(size + 1)))
+        {
+            *length = (int)fread(file, sizeof(char), size, fp);
+            file[*length] = '\0';
+        }
 
         fclose(fp);
     }
 
+    if (! file)
+        fprintf(stderr, ERR_SHADER_READ, filename);
+
     return file;
 }
@@ -3,30 +3,95 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "pack.h"
 
 #define ERR_SHADER_MALLOC "Error: unable to allocate memory for shader\n"
+#define ERR_SHADER_READ "Error: unable to read shader file \"%s\"\n"
 #define ERR_SHADER "Error: shader file \"%s\" failed to compile\n%s"
 #define ERR_PROGRAM "Error: shader file \"%s\" failed to link\n%s"
+#define ERR_SHADER_INCLUDE "Error: shader file \"%s\" has a bad #include\n"
+#define ERR_SHADER_VARIANTS "Error: shader \"%s\" has too many variants\n"
+
+#define ERR_UNIFORM_COUNT "Error: shader \"%s\" has too many uniforms\n"
+
+#define MAX_UNIFORMS 128
+#define UNIFORM_NAME_SIZE 64
+#define UNIFORM_CACHE_SIZE 64
+
+#define MAX_SHADER_VARIANTS 8
+#define MAX_INCLUDE_DEPTH 8
 
 #define UNIFORM_LOC(shaderPtr, name) \
-    glGetUniformLocation((shaderPtr)->ID, (name))
+    (shaderPtr)->getUniformLocation((shaderPtr), (name))
 
 typedef enum {SHADER, PROGRAM} Type;
 
+typedef struct ShaderUniform
+{
+    char name[UNIFORM_NAME_SIZE];
+    int location;
+} ShaderUniform;
+
+
+typedef struct UniformCacheSlot
+{
+    const char* key;
+    ShaderUniform* uniform;
+} UniformCacheSlot;
+
+
+// One linked variant. Compiling and linking are only started when it is made,
+// nothing waits on the driver until the program is first needed
+typedef struct ShaderProgram
+{
+    unsigned int ID;
+    unsigned int stages[2];
+    uint64_t key;
+
+    bool pending;
+
+    // Loaded from the program binary cache rather than compiled
+    bool cached;
+
+    // Active uniforms queried once after linking, sorted by name
+    ShaderUniform uniforms[MAX_UNIFORMS];
+    int uniformCount;
+
+    // Direct mapped cache keyed by the address of the name passed in, so
+    // repeated calls with the same string literal skip the name search
+    UniformCacheSlot cache[UNIFORM_CACHE_SIZE];
+} ShaderProgram;
+
+
+// Every variant is the same pair of sources with different #defines injected
+// after #version. The setters and use act on the selected variant
 typedef struct Shader
 {
+    // Selected variant's program
     unsigned int ID;
+
     char vertexFilename[BUFSIZ];
     char fragmentFilename[BUFSIZ];
 
+    ShaderProgram programs[MAX_SHADER_VARIANTS];
+    int variantCount;
+    int variant;
+
+    int (*getUniformLocation)(struct Shader*, const char*);
     void (*use)(struct Shader*);
+    void (*setVariant)(struct Shader*, int);
+    void (*finish)(struct Shader*);
     void (*setBool)(struct Shader*, const char*, bool);
     void (*setInt)(struct Shader*, const char*, int);
     void (*setFloat)(struct Shader*, const char*, float);
+    void (*setMat3)(struct Shader*, const char*, mat3);
     void (*setMat4)(struct Shader*, const char*, mat4);
     void (*setVec3)(struct Shader*, const char*, vec3);
 } Shader;
 
-Shader* newShader(char*, char*);
+Shader* newShader(Pack*, char*, char*, const char**, int);
+bool parallelShaderCompile(void);
 
 #endif
@@ -0,0 +1,162 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <glad/glad.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "macros.h"
+
+#include "shadercache.h"
+
+
+static uint64_t hashBytes(uint64_t, const void*, size_t);
+
+
+// Anything that changes what the driver would compile changes the key, so a
+// stale binary is simply never looked up
+uint64_t hashProgram(const char** sources, int* lengths, int count,
+                     const char* defines)
+{
+    const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    const char* string;
+    uint64_t key = FNV64_OFFSET;
+
+    for (int i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+        if ((string = (const char*)glGetString(strings[i])))
+            key = hashBytes(key, string, strlen(string) + 1);
+
+    if (defines)
+        key = hashBytes(key, defines, strlen(defines));
+
+    // Lengths go in too, so moving text between stages changes the key
+    for (int i = 0; i < count; i++)
+    {
+        key = hashBytes(key, lengths + i, sizeof(int));
+        key = hashBytes(key, sources[i], lengths[i]);
+    }
+
+    return key;
+}
+
+
+unsigned int loadProgramBinary(uint64_t key)
+{
+    ShaderCacheHeader header;
+    char filename[BUFSIZ];
+    unsigned int ID = 0;
+    void* binary = NULL;
+    int success = 0;
+    FILE* fp;
+
+    snprintf(filename, BUFSIZ, SHADER_CACHE_FORMAT, (unsigned long long)key);
+
+    if (! (fp = fopen(filename, "rb")))
+        return 0;
+
+    if (fread(&header, sizeof(ShaderCacheHeader), 1, fp) == 1 &&
+        header.magic == SHADER_CACHE_MAGIC && header.key == key &&
+        header.length > 0 && header.length <= INT32_MAX &&
+        (binary = malloc(header.length)) &&
+        fread(binary, 1, header.length, fp) == header.length)
+    {
+        ID = glCreateProgram();
+        glProgramBinary(ID, header.format, binary, (int)header.length);
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+
+        // Rejected after a driver update the strings did not reflect, the
+        // caller compiles from source and overwrites it
+        if (! success)
+        {
+            glDeleteProgram(ID);
+            ID = 0;
+        }
+    }
+
+    SAFE_FREE(binary);
+    fclose(fp);
+
+    return ID;
+}
+
+
+void saveProgramBinary(unsigned int ID, uint64_t key)
+{
+    ShaderCacheHeader header;
+    char filename[BUFSIZ];
+    char temporary[BUFSIZ];
+    void* binary;
+    int length = 0;
+    bool ok = false;
+    GLenum format;
+    FILE* fp;
+
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0 || ! (binary = malloc(length)))
+        return;
+
+    glGetProgramBinary(ID, length, &length, &format, binary);
+
+    memset(&header, 0, sizeof(ShaderCacheHeader));
+    header.magic = SHADER_CACHE_MAGIC;
+    header.format = format;
+    header.key = key;
+    header.length = length;
+
+    snprintf(filename, BUFSIZ, SHADER_CACHE_FORMAT, (unsigned long long)key);
+    snprintf(temporary, BUFSIZ, SHADER_CACHE_FORMAT ".tmp",
+             (unsigned long long)key);
+
+    // Already there is fine, anything else shows up when opening the file
+    mkdir(SHADER_CACHE_DIR, 0755);
+
+    // Written aside and renamed, so a crash never leaves half a binary
+    if ((fp = fopen(temporary, "wb")))
+    {
+        ok = fwrite(&header, sizeof(ShaderCacheHeader), 1, fp) == 1 &&
+             fwrite(binary, 1, length, fp) == (size_t)length;
+        ok = ! fclose(fp) && ok && ! rename(temporary, filename);
+    }
+
+    if (! ok)
+    {
+        fprintf(stderr, ERR_SHADER_CACHE_WRITE, filename);
+        remove(temporary);
+    }
+
+    SAFE_FREE(binary);
+}
+
+
+bool programBinarySupported(void)
+{
+    int formats = 0;
+
+    // Core only from 4.1, GLAD is generated for 3.3 so go by the extension
+    if (! GLAD_GL_ARB_get_program_binary)
+        return false;
+
+    // Drivers may expose the entry points with nothing to hand back
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    return formats > 0;
+}
+
+
+static uint64_t hashBytes(uint64_t value, const void* data, size_t length)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        value ^= bytes[i];
+        value *= FNV64_PRIME;
+    }
+
+    return value;
+}
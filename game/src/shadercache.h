@@ -0,0 +1,34 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ERR_SHADER_CACHE_WRITE "Error: unable to write shader cache \"%s\"\n"
+
+// Relative to the working directory, like the resources
+#define SHADER_CACHE_DIR "shader_cache"
+#define SHADER_CACHE_FORMAT SHADER_CACHE_DIR "/%016llx.bin"
+#define SHADER_CACHE_MAGIC 0x48434853
+
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+
+// Stored in front of the driver's blob, the key is repeated in case two
+// programs ever land on the same file
+typedef struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint64_t length;
+} ShaderCacheHeader;
+
+
+uint64_t hashProgram(const char**, int*, int, const char*);
+unsigned int loadProgramBinary(uint64_t);
+void saveProgramBinary(unsigned int, uint64_t);
+bool programBinarySupported(void);
+
+#endif
@@ -0,0 +1,17 @@
+// Camera and light for the whole frame, laid out like FrameUniforms in
+// uniforms.h and shared by every program
+layout (std140) uniform Frame
+{
+    mat4 projection;
+    mat4 view;
+
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightDirection;
+
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+} frame;
@@ -0,0 +1,39 @@
+// Light colours are compiled in by each variant. There is no diffuse term
+// unless LIGHT_DIFFUSE is defined
+#ifndef LIGHT_AMBIENT
+#define LIGHT_AMBIENT vec3(1.0)
+#endif
+
+#ifndef LIGHT_SPECULAR
+#define LIGHT_SPECULAR vec3(1.0)
+#endif
+
+#include "frame.glsl"
+
+// Laid out like MaterialUniforms in uniforms.h, one range of the buffer is
+// bound per material
+layout (std140) uniform MaterialBlock
+{
+    float shininess;
+    int diffuseLayer;
+    int specularLayer;
+} material;
+
+// Texture units, samplers cannot go in a block
+uniform sampler2DArray diffuseMap;
+uniform sampler2DArray specularMap;
+
+float spotIntensity(vec3 lightDir)
+{
+    float theta = dot(lightDir, normalize(-frame.lightDirection.xyz));
+    float epsilon = frame.cutOff - frame.outerCutOff;
+
+    return clamp((theta - frame.outerCutOff) / epsilon, 0.0, 1.0);
+}
+
+float attenuation(vec3 position)
+{
+    float distance = length(frame.lightPosition.xyz - position);
+
+    return 1.0 / (frame.constant + frame.linear * distance + frame.quadratic * (distance * distance));
+}
@@ -5,76 +5,48 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
 
-struct Material
-{
-    sampler2D diffuse;
-    sampler2D specular;
-    float shininess;
-};
-
-struct Light
-{
-    vec3 position;
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float cutOff;
-    float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-// texture samplers
-uniform sampler2D texture1;
-
-uniform vec3 viewPos;
-uniform bool lightsOn;
-
-uniform Material material;
-uniform Light light;
+#include "lighting.glsl"
 
 void main()
 {
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(frame.lightPosition.xyz - FragPos);
 
     // ambient
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoord));
-
-    // diffuse
-    vec3 norm = normalize(Normal);
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoord));
+    vec3 diffuseColor = vec3(texture(diffuseMap, vec3(TexCoord, material.diffuseLayer)));
+    vec3 ambient = LIGHT_AMBIENT * diffuseColor;
 
     // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(frame.viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * (spec * vec3(texture(material.specular, TexCoord)));
+    vec3 specular = LIGHT_SPECULAR * (spec * vec3(texture(specularMap, vec3(TexCoord, material.specularLayer))));
+
+    // spot light and attenuation, only compiled in when the lights are off
+#ifdef SPOTLIGHT
+    float intensity = spotIntensity(lightDir);
+    float falloff = attenuation(FragPos);
 
-    // spot light
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    specular *= intensity;
+    ambient *= falloff;
+    specular *= falloff;
+#endif
 
-    // attenuation
-    float distance = length(light.position - FragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    vec3 color = ambient;
+
+    // diffuse, left out entirely by variants whose light has none
+#ifdef LIGHT_DIFFUSE
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = LIGHT_DIFFUSE * diff * diffuseColor;
 
-    if (! lightsOn)
-    {
-        diffuse *= intensity;
-        specular *= intensity;
+#ifdef SPOTLIGHT
+    diffuse *= intensity;
+    diffuse *= falloff;
+#endif
 
-        ambient *= attenuation;
-        diffuse *= attenuation;
-        specular *= attenuation;
-    }
+    color += diffuse;
+#endif
 
     // result
-    FragColor = vec4(ambient + diffuse + specular, 1.0);
+    FragColor = vec4(color + specular, 1.0);
 }
@@ -2,19 +2,32 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in mat4 aInstance;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 
+#include "frame.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
+
+// Inverse transpose of model, worked out per draw by the renderer. Instance
+// matrices only rotate, translate and scale uniformly, so their own upper 3x3
+// is good enough once Normal is normalised
+uniform mat3 normalMatrix;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    mat4 world = instanced ? aInstance * model : model;
+
+    FragPos = vec3(world * vec4(aPos, 1.0));
+    Normal = normalMatrix * aNormal;
+
+    if (instanced)
+        Normal = mat3(aInstance) * Normal;
+
     TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = frame.projection * frame.view * vec4(FragPos, 1.0);
 }
@@ -5,51 +5,200 @@
 #include <stb_image.h>
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "loader.h"
 #include "macros.h"
+#include "pack.h"
 #include "texture.h"
 
 
-Texture* newTexture(char* filename, unsigned int rgbMode, bool flip)
+static void allocateArray(Texture**, int, unsigned int);
+static void uploadLayer(Texture*, LoadedImage*, unsigned int);
+static void uploadPacked(Texture*, Pack*, const PackEntry*);
+
+
+bool packTextures(Texture** textures, Loader* loader, unsigned int rgbMode)
 {
+    LoadedImage image;
     Texture* texture;
+    bool loaded = true;
+
+    // Sizes arrive well ahead of the pixels, so every array can be allocated
+    // before the first image is decoded
+    for (int i = 0; i < loader->count; i++)
+    {
+        if (! (textures[i] = (Texture*)malloc(sizeof(Texture))))
+        {
+            fprintf(stderr, ERR_TEXTURE_MALLOC);
+            loaded = false;
+            continue;
+        }
+
+        memset(textures[i], 0, sizeof(Texture));
+        strncpy(textures[i]->filename, loader->filenames[i], BUFSIZ - 1);
+        textures[i]->levels = 1;
 
-    int width;
-    int height;
-    int nrChannels;
-    unsigned char* data;
+        if (! loader->getSize(loader, i, &(textures[i]->width),
+                              &(textures[i]->height)))
+        {
+            fprintf(stderr, ERR_TEXTURE_LOAD, loader->filenames[i]);
+            SAFE_FREE(textures[i]);
+            loaded = false;
+        }
+    }
 
-    if (! (texture = (Texture*)malloc(sizeof(Texture))))
+    for (int i = 0; i < loader->count; i++)
+        if (textures[i] && ! textures[i]->ID)
+            allocateArray(textures + i, loader->count - i, rgbMode);
+
+    // Upload in whatever order the workers finish decoding
+    while (loader->next(loader, &image))
     {
-        fprintf(stderr, ERR_TEXTURE_MALLOC);
-        return NULL;
+        if ((texture = textures[image.index]) && image.data)
+            uploadLayer(texture, &image, rgbMode);
+        else if (texture)
+        {
+            fprintf(stderr, ERR_TEXTURE_LOAD, texture->filename);
+            SAFE_FREE(textures[image.index]);
+            loaded = false;
+        }
+
+        if (image.data)
+            stbi_image_free(image.data);
     }
 
-    glGenTextures(1, &(texture->ID));
-    glBindTexture(GL_TEXTURE_2D, texture->ID);
+    return loaded;
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    if ((data = stbi_load(filename, &width, &height, &nrChannels, 0)))
+bool packTexturesFromPack(Texture** textures, Pack* pack, char** filenames,
+                          int count)
+{
+    const PackEntry* entry;
+    bool loaded = true;
+
+    // Same layout as above, except the pixels are already decoded, mipmapped
+    // and sitting in the mapping
+    for (int i = 0; i < count; i++)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, rgbMode,
-                     GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_set_flip_vertically_on_load(! flip);
-        stbi_image_free(data);
+        textures[i] = NULL;
 
-        strncpy(texture->filename, filename, BUFSIZ);
+        if (! (entry = pack->find(pack, filenames[i])) ||
+            entry->type != PACK_IMAGE)
+        {
+            fprintf(stderr, ERR_TEXTURE_LOAD, filenames[i]);
+            loaded = false;
+            continue;
+        }
+
+        if (! (textures[i] = (Texture*)malloc(sizeof(Texture))))
+        {
+            fprintf(stderr, ERR_TEXTURE_MALLOC);
+            loaded = false;
+            continue;
+        }
+
+        memset(textures[i], 0, sizeof(Texture));
+        strncpy(textures[i]->filename, filenames[i], BUFSIZ - 1);
+        textures[i]->width = entry->width;
+        textures[i]->height = entry->height;
+        textures[i]->levels = entry->levels;
     }
-    else
+
+    for (int i = 0; i < count; i++)
+        if (textures[i] && ! textures[i]->ID)
+            allocateArray(textures + i, count - i, GL_RGBA);
+
+    for (int i = 0; i < count; i++)
+        if (textures[i])
+            uploadPacked(textures[i], pack,
+                         pack->find(pack, textures[i]->filename));
+
+    return loaded;
+}
+
+
+void deleteTextures(Texture** textures, int count)
+{
+    // Arrays are shared, delete each one once
+    for (int i = 0; i < count; i++)
     {
-        fprintf(stderr, ERR_TEXTURE_LOAD, filename);
+        if (! textures[i] || ! textures[i]->ID)
+            continue;
+
+        glDeleteTextures(1, &(textures[i]->ID));
+
+        for (int j = count - 1; j >= i; j--)
+            if (textures[j] && textures[j]->ID == textures[i]->ID)
+                textures[j]->ID = 0;
+    }
+}
+
+
+static void allocateArray(Texture** textures, int count, unsigned int rgbMode)
+{
+    Texture* first = textures[0];
+    unsigned int ID;
+    int layers = 0;
+
+    glGenTextures(1, &ID);
 
-        SAFE_FREE(texture);
-        return NULL;
+    // The first texture and every later one of the same size go in this array
+    for (int i = 0; i < count; i++)
+    {
+        if (textures[i] && ! textures[i]->ID &&
+            textures[i]->width == first->width &&
+            textures[i]->height == first->height)
+        {
+            textures[i]->layer = layers++;
+            textures[i]->ID = ID;
+        }
     }
 
-    return texture;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // Only packs carry a mip chain, nothing is generated at runtime. Nearest
+    // filtering still only samples the base level
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                    first->levels - 1);
+
+    for (int i = 0; i < first->levels; i++)
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGB,
+                     MAX(first->width >> i, 1), MAX(first->height >> i, 1),
+                     layers, 0, rgbMode, GL_UNSIGNED_BYTE, NULL);
+}
+
+
+static void uploadLayer(Texture* this, LoadedImage* image,
+                        unsigned int rgbMode)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->ID);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, this->layer,
+                    this->width, this->height, 1, rgbMode, GL_UNSIGNED_BYTE,
+                    image->data);
+}
+
+
+static void uploadPacked(Texture* this, Pack* pack, const PackEntry* entry)
+{
+    const unsigned char* data = (const unsigned char*)pack->getData(pack,
+                                                                    entry);
+
+    // Straight from the mapping, the driver copies it and the pages can go
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->ID);
+
+    for (int i = 0; i < this->levels; i++)
+    {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, this->layer,
+                        MAX(this->width >> i, 1), MAX(this->height >> i, 1),
+                        1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        data += packLevelSize(entry, i);
+    }
 }
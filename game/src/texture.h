@@ -1,16 +1,30 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "loader.h"
+#include "pack.h"
+
 #define ERR_TEXTURE_MALLOC "Error: unable to allocate memory for texture\n"
 #define ERR_TEXTURE_LOAD "Error: texture \"%s\" failed to load\n"
 
+// Textures of the same size share one GL_TEXTURE_2D_ARRAY, ID is the array
+// and layer is the texture's slice of it
 typedef struct Texture
 {
     unsigned int ID;
+    int layer;
+    int width;
+    int height;
+    int levels;
     char filename[BUFSIZ];
 } Texture;
 
 
-Texture* newTexture(char* filename, unsigned int rgbMode, bool flip);
+bool packTextures(Texture**, Loader*, unsigned int);
+bool packTexturesFromPack(Texture**, Pack*, char**, int);
+void deleteTextures(Texture**, int);
 
 #endif
@@ -0,0 +1,38 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <GLFW/glfw3.h>
+
+#include <time.h>
+
+#include "timer.h"
+
+
+static double fixedStep = 0.0;
+static double fixedTime = 0.0;
+
+
+double getTime()
+{
+    return fixedStep > 0.0 ? fixedTime : glfwGetTime();
+}
+
+
+void setFixedTimestep(double step)
+{
+    fixedStep = step;
+    fixedTime = 0.0;
+}
+
+
+void advanceTime()
+{
+    fixedTime += fixedStep;
+}
+
+
+double getWallTime()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1.0e9;
+}
@@ -0,0 +1,14 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// Game time in seconds. Normally the GLFW clock, a fixed step makes time
+// advance only through advanceTime so runs are repeatable
+double getTime(void);
+void setFixedTimestep(double);
+void advanceTime(void);
+
+// Monotonic wall clock in seconds, usable before GLFW is initialised and
+// unaffected by a fixed step
+double getWallTime(void);
+
+#endif
@@ -0,0 +1,197 @@
+#include <cglm/vec3.h>
+#include <cglm/mat4.h>
+#include <cglm/util.h>
+
+#include <math.h>
+
+#include "macros.h"
+
+#include "transform.h"
+
+
+#ifdef CGLM_SSE_FP
+static __m128 gather(vec3*, int);
+static void sincos4(__m128, __m128*, __m128*);
+static void transform4(vec3*, vec3*, vec3*, vec3*, mat4*);
+#endif
+
+
+void transformBatch(vec3* position, vec3* rotation, vec3* modelPosition,
+                    vec3* scale, mat4* dest, int count)
+{
+    int i = 0;
+
+#ifdef CGLM_SSE_FP
+    // Each SSE lane holds a different box
+    for (; i + 4 <= count; i += 4)
+        transform4(position + i, rotation + i, modelPosition + i, scale + i,
+                   dest + i);
+#endif
+
+    for (; i < count; i++)
+        transformSingle(position[i], rotation[i], modelPosition[i], scale[i],
+                        dest[i]);
+}
+
+
+void transformSingle(vec3 position, vec3 rotation, vec3 modelPosition,
+                     vec3 scale, mat4 dest)
+{
+    float sa = sinf(glm_rad(rotation[X_COORD]));
+    float ca = cosf(glm_rad(rotation[X_COORD]));
+    float sb = sinf(glm_rad(rotation[Y_COORD]));
+    float cb = cosf(glm_rad(rotation[Y_COORD]));
+    float sc = sinf(glm_rad(rotation[Z_COORD]));
+    float cc = cosf(glm_rad(rotation[Z_COORD]));
+
+    // Rx * Ry * Rz expanded, r[column][row] like mat4
+    mat3 r = {
+        {cb * cc, ca * sc + sa * sb * cc, sa * sc - ca * sb * cc},
+        {-cb * sc, ca * cc - sa * sb * sc, sa * cc + ca * sb * sc},
+        {sb, -sa * cb, ca * cb}
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            dest[i][j] = r[i][j] * scale[i];
+
+        dest[i][3] = 0.0f;
+        dest[3][i] = r[0][i] * modelPosition[X_COORD] +
+                     r[1][i] * modelPosition[Y_COORD] +
+                     r[2][i] * modelPosition[Z_COORD] + position[i];
+    }
+
+    dest[3][3] = 1.0f;
+}
+
+
+#ifdef CGLM_SSE_FP
+static __m128 gather(vec3* v, int axis)
+{
+    // One component of four consecutive vectors
+    return _mm_setr_ps(v[0][axis], v[1][axis], v[2][axis], v[3][axis]);
+}
+
+
+static void sincos4(__m128 x, __m128* sinOut, __m128* cosOut)
+{
+    // Cephes style sincosf, four angles at once
+    __m128 sign = _mm_and_ps(x, _mm_set1_ps(-0.0f));
+    __m128 y, z, sinPoly, cosPoly, mask;
+    __m128 sinSign, cosSign;
+    __m128i j;
+
+    x = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+
+    // Octant of |x|, rounded up to even
+    j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    j = _mm_add_epi32(j, _mm_set1_epi32(1));
+    j = _mm_and_si128(j, _mm_set1_epi32(~1));
+    y = _mm_cvtepi32_ps(j);
+
+    // x - y * pi / 4 in extended precision
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+
+    sinSign = _mm_xor_ps(sign, _mm_castsi128_ps(_mm_slli_epi32(
+        _mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+    cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(
+        _mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+    mask = _mm_castsi128_ps(_mm_cmpeq_epi32(
+        _mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+    z = _mm_mul_ps(x, x);
+
+    cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z),
+                         _mm_set1_ps(-1.388731625493765e-3f));
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z),
+                         _mm_set1_ps(4.166664568298827e-2f));
+    cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+    cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+    sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z),
+                         _mm_set1_ps(8.3321608736e-3f));
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z),
+                         _mm_set1_ps(-1.6666654611e-1f));
+    sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+    *sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(mask, sinPoly),
+                                   _mm_andnot_ps(mask, cosPoly)), sinSign);
+    *cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(mask, cosPoly),
+                                   _mm_andnot_ps(mask, sinPoly)), cosSign);
+}
+
+
+static void transform4(vec3* position, vec3* rotation, vec3* modelPosition,
+                       vec3* scale, mat4* dest)
+{
+    __m128 rad = _mm_set1_ps(GLM_PIf / 180.0f);
+    __m128 sa, ca, sb, cb, sc, cc, sacb, casb;
+    __m128 r[3][3], m[3], t[3], s, c0, c1, c2, c3;
+
+    sincos4(_mm_mul_ps(gather(rotation, X_COORD), rad), &sa, &ca);
+    sincos4(_mm_mul_ps(gather(rotation, Y_COORD), rad), &sb, &cb);
+    sincos4(_mm_mul_ps(gather(rotation, Z_COORD), rad), &sc, &cc);
+
+    sacb = _mm_mul_ps(sa, sb);
+    casb = _mm_mul_ps(ca, sb);
+
+    // Rx * Ry * Rz expanded, r[column][row] like mat4
+    r[0][0] = _mm_mul_ps(cb, cc);
+    r[0][1] = _mm_add_ps(_mm_mul_ps(ca, sc), _mm_mul_ps(sacb, cc));
+    r[0][2] = _mm_sub_ps(_mm_mul_ps(sa, sc), _mm_mul_ps(casb, cc));
+    r[1][0] = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cb, sc));
+    r[1][1] = _mm_sub_ps(_mm_mul_ps(ca, cc), _mm_mul_ps(sacb, sc));
+    r[1][2] = _mm_add_ps(_mm_mul_ps(sa, cc), _mm_mul_ps(casb, sc));
+    r[2][0] = sb;
+    r[2][1] = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sa, cb));
+    r[2][2] = _mm_mul_ps(ca, cb);
+
+    for (int i = 0; i < 3; i++)
+        m[i] = gather(modelPosition, i);
+
+    // Translation, one row at a time across the four boxes
+    for (int i = 0; i < 3; i++)
+    {
+        t[i] = _mm_mul_ps(r[0][i], m[X_COORD]);
+        t[i] = _mm_add_ps(t[i], _mm_mul_ps(r[1][i], m[Y_COORD]));
+        t[i] = _mm_add_ps(t[i], _mm_mul_ps(r[2][i], m[Z_COORD]));
+        t[i] = _mm_add_ps(t[i], gather(position, i));
+    }
+
+    // Scaled rotation columns, transposed so each lane becomes its own box
+    for (int i = 0; i < 3; i++)
+    {
+        s = gather(scale, i);
+        c0 = _mm_mul_ps(r[i][0], s);
+        c1 = _mm_mul_ps(r[i][1], s);
+        c2 = _mm_mul_ps(r[i][2], s);
+        c3 = _mm_setzero_ps();
+
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        glmm_store(dest[0][i], c0);
+        glmm_store(dest[1][i], c1);
+        glmm_store(dest[2][i], c2);
+        glmm_store(dest[3][i], c3);
+    }
+
+    c0 = t[X_COORD];
+    c1 = t[Y_COORD];
+    c2 = t[Z_COORD];
+    c3 = _mm_set1_ps(1.0f);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    glmm_store(dest[0][3], c0);
+    glmm_store(dest[1][3], c1);
+    glmm_store(dest[2][3], c2);
+    glmm_store(dest[3][3], c3);
+}
+#endif
@@ -0,0 +1,13 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cglm/vec3.h>
+#include <cglm/mat4.h>
+
+// Both build T(position) * Rx * Ry * Rz * T(modelPosition) * S(scale), with
+// the rotation given in degrees. The batch version works on four boxes at a
+// time when SSE is available
+void transformBatch(vec3*, vec3*, vec3*, vec3*, mat4*, int);
+void transformSingle(vec3, vec3, vec3, vec3, mat4);
+
+#endif
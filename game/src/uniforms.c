@@ -0,0 +1,128 @@
+#include <glad/glad.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+
+#include "uniforms.h"
+
+
+static void linkMethods(UniformBuffer*);
+
+static void* map(UniformBuffer*, size_t);
+static void unmap(UniformBuffer*);
+static void update(UniformBuffer*, const void*, size_t);
+static void bindRange(UniformBuffer*, size_t, size_t);
+static void destroy(UniformBuffer*);
+
+
+UniformBuffer* newUniformBuffer(int binding, size_t size)
+{
+    UniformBuffer* buffer;
+
+    if (! (buffer = (UniformBuffer*)malloc(sizeof(UniformBuffer))))
+    {
+        fprintf(stderr, ERR_UNIFORMS_MALLOC);
+        return NULL;
+    }
+
+    memset(buffer, 0, sizeof(UniformBuffer));
+    linkMethods(buffer);
+
+    buffer->binding = binding;
+    buffer->size = size;
+
+    glGenBuffers(1, &(buffer->ID));
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer->ID);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer->ID);
+
+    return buffer;
+}
+
+
+// Every program gets the same binding points, GLSL 330 has no binding
+// layout qualifier so it is done here after linking or loading a binary
+void bindUniformBlocks(unsigned int program)
+{
+    const char* names[] = {FRAME_BLOCK_NAME, MATERIAL_BLOCK_NAME};
+    const int bindings[] = {FRAME_BLOCK_BINDING, MATERIAL_BLOCK_BINDING};
+    unsigned int index;
+
+    for (int i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        if ((index = glGetUniformBlockIndex(program, names[i])) !=
+            GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, bindings[i]);
+}
+
+
+// Size of each element when an array of blocks is bound one range at a time
+size_t uniformBlockStride(size_t size)
+{
+    int alignment = 0;
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = MAX(alignment, 1);
+
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+
+static void linkMethods(UniformBuffer* this)
+{
+    this->map = map;
+    this->unmap = unmap;
+    this->update = update;
+    this->bindRange = bindRange;
+    this->destroy = destroy;
+}
+
+
+static void* map(UniformBuffer* this, size_t size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, this->ID);
+
+    if (size > this->size)
+    {
+        this->size = MAX(size, 2 * this->size);
+        glBufferData(GL_UNIFORM_BUFFER, this->size, NULL, GL_STREAM_DRAW);
+    }
+
+    return glMapBufferRange(GL_UNIFORM_BUFFER, 0, size,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+
+static void unmap(UniformBuffer* this)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, this->ID);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+}
+
+
+static void update(UniformBuffer* this, const void* data, size_t size)
+{
+    void* mapped;
+
+    if ((mapped = map(this, size)))
+    {
+        memcpy(mapped, data, size);
+        unmap(this);
+    }
+}
+
+
+static void bindRange(UniformBuffer* this, size_t offset, size_t size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, this->binding, this->ID, offset,
+                      size);
+}
+
+
+static void destroy(UniformBuffer* this)
+{
+    glDeleteBuffers(1, &(this->ID));
+    this->ID = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef UNIFORMS_H
+#define UNIFORMS_H
+
+#include <cglm/mat4.h>
+#include <cglm/vec4.h>
+
+#include <stddef.h>
+
+#define ERR_UNIFORMS_MALLOC "Error: unable to allocate memory for uniform buffer\n"
+
+// Binding points shared by every program, see bindUniformBlocks
+#define FRAME_BLOCK_BINDING 0
+#define MATERIAL_BLOCK_BINDING 1
+
+#define FRAME_BLOCK_NAME "Frame"
+#define MATERIAL_BLOCK_NAME "MaterialBlock"
+
+
+// std140 layout of the Frame block in shaders/frame.glsl. Directions and
+// positions are vec4 on both sides so nothing depends on vec3 packing rules
+typedef struct FrameUniforms
+{
+    mat4 projection;
+    mat4 view;
+
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightDirection;
+
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+} FrameUniforms;
+
+
+// std140 layout of MaterialBlock in shaders/lighting.glsl
+typedef struct MaterialUniforms
+{
+    float shininess;
+    int diffuseLayer;
+    int specularLayer;
+    int padding;
+} MaterialUniforms;
+
+
+// Rewritten whole every time it is mapped, the old contents are orphaned so
+// the driver never stalls on draws still reading them
+typedef struct UniformBuffer
+{
+    unsigned int ID;
+    int binding;
+    size_t size;
+
+    void* (*map)(struct UniformBuffer*, size_t);
+    void (*unmap)(struct UniformBuffer*);
+    void (*update)(struct UniformBuffer*, const void*, size_t);
+    void (*bindRange)(struct UniformBuffer*, size_t, size_t);
+    void (*destroy)(struct UniformBuffer*);
+} UniformBuffer;
+
+
+UniformBuffer* newUniformBuffer(int, size_t);
+void bindUniformBlocks(unsigned int);
+size_t uniformBlockStride(size_t);
+
+#endif
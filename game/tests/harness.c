@@ -0,0 +1,132 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "harness.h"
+
+
+static const char* resultNames[] = {"passed", "failed", "skipped"};
+
+static FILE* captured = NULL;
+static int savedStderr = -1;
+
+
+int runCases(const HarnessCase* cases, int count, int argc, char** argv)
+{
+    CaseResult result;
+    int ran = 0;
+    int failed = 0;
+    int skipped = 0;
+    double start;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (argc > 1 && strcmp(argv[1], cases[i].name))
+            continue;
+
+        ran++;
+        start = harnessTime();
+        result = cases[i].run();
+
+        printf(LOG_HARNESS_CASE, cases[i].name, resultNames[result],
+               harnessTime() - start);
+        fflush(stdout);
+
+        failed += result == CASE_FAIL;
+        skipped += result == CASE_SKIP;
+    }
+
+    if (! ran)
+    {
+        fprintf(stderr, ERR_HARNESS_CASE, argc > 1 ? argv[1] : "");
+        return EXIT_FAILURE;
+    }
+
+    if (failed)
+        return EXIT_FAILURE;
+
+    // Only a skip when nothing could run at all
+    return skipped == ran ? HARNESS_SKIP : EXIT_SUCCESS;
+}
+
+
+double harnessTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1.0e9;
+}
+
+
+float randomUnit(unsigned int* seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+
+    return (float)(*seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+
+int randomIndex(unsigned int* seed, int count)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+
+    return (int)((*seed >> 8) % count);
+}
+
+
+bool captureStderr(void)
+{
+    fflush(stderr);
+
+    if (! (captured = tmpfile()))
+    {
+        fprintf(stderr, ERR_HARNESS_CAPTURE);
+        return false;
+    }
+
+    if ((savedStderr = dup(STDERR_FILENO)) < 0 ||
+        dup2(fileno(captured), STDERR_FILENO) < 0)
+    {
+        if (savedStderr >= 0)
+            close(savedStderr);
+
+        fclose(captured);
+        captured = NULL;
+        savedStderr = -1;
+
+        fprintf(stderr, ERR_HARNESS_CAPTURE);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool releaseStderr(char* buffer, int size)
+{
+    size_t length;
+
+    if (! captured)
+        return false;
+
+    fflush(stderr);
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStderr);
+
+    rewind(captured);
+    length = fread(buffer, 1, size - 1, captured);
+    buffer[length] = '\0';
+
+    fclose(captured);
+    captured = NULL;
+    savedStderr = -1;
+
+    return true;
+}
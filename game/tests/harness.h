@@ -0,0 +1,45 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// ctest reads this exit code as a skip rather than a failure
+#define HARNESS_SKIP 77
+
+#define ERR_HARNESS_CASE "Error: no case named \"%s\"\n"
+#define ERR_HARNESS_CAPTURE "Error: unable to capture stderr\n"
+
+#define LOG_HARNESS_CASE "%s: %s in %.3f s\n"
+
+
+typedef enum {CASE_PASS, CASE_FAIL, CASE_SKIP} CaseResult;
+
+
+// One check or timing run. Cases print their own measurements and an Error:
+// line for whatever failed
+typedef struct HarnessCase
+{
+    const char* name;
+    CaseResult (*run)(void);
+} HarnessCase;
+
+
+// Runs the case named on the command line, or every case, and returns the
+// exit code for ctest
+int runCases(const HarnessCase*, int, int, char**);
+
+// Monotonic seconds
+double harnessTime(void);
+
+// Seeded so every run sees the same inputs, between -1 and 1 and between 0
+// and count - 1
+float randomUnit(unsigned int*);
+int randomIndex(unsigned int*, int);
+
+// Sends stderr to a temporary file until it is released, which reads what
+// was written into the buffer
+bool captureStderr(void);
+bool releaseStderr(char*, int);
+
+#endif
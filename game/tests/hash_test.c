@@ -0,0 +1,253 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashtable.h"
+#include "macros.h"
+
+#include "harness.h"
+#include "reftable.h"
+
+// Pseudo random inserts, searches and deletes on a pool of keys up to the
+// inline limit, checked against the old table after every one. Phases
+// alternate between mostly inserting and mostly deleting, so the table grows
+// past 70% load and shrinks below 10%
+#define HASH_KEYS 4096
+#define HASH_PHASE 16384
+#define HASH_OPERATIONS 262144
+#define HASH_LOOKUPS 1000000
+
+#define ERR_HASH_MALLOC "Error: unable to allocate memory for hash table test\n"
+#define ERR_HASH_MISMATCH "Error: hash table and reference disagree on %d of %d checks\n"
+#define ERR_HASH_LONG_KEY "Error: hash table kept or truncated a key of %d characters\n"
+#define ERR_HASH_LOOKUPS "Error: lookups found %d and %d of %d keys\n"
+
+
+static CaseResult compareOperations(void);
+static CaseResult compareLookups(void);
+static bool checkLongKey(HashTable*, int*);
+static char (*makeKeys(void))[HASHTABLE_KEY_SIZE];
+
+
+static const HarnessCase cases[] = {
+    {"differential", compareOperations},
+    {"lookups", compareLookups}
+};
+
+
+int main(int argc, char** argv)
+{
+    return runCases(cases, sizeof(cases) / sizeof(cases[0]), argc, argv);
+}
+
+
+static CaseResult compareOperations(void)
+{
+    unsigned int seed = 2;
+    int mismatches = 0;
+    int checks = 0;
+    int values[HASH_KEYS];
+    int key;
+    int roll;
+    int found;
+    bool filling;
+    void* value;
+
+    char (*keys)[HASHTABLE_KEY_SIZE];
+    HashEntry* iter;
+    HashTable* table = NULL;
+    RefTable* reference = NULL;
+
+    if (! (keys = makeKeys()) || ! (table = newHashTable()) ||
+        ! (reference = newRefTable()))
+    {
+        fprintf(stderr, ERR_HASH_MALLOC);
+        if (table)
+            table->deleteHashTableShallow(&table);
+        SAFE_FREE(keys);
+        return CASE_FAIL;
+    }
+
+    for (int op = 0; op < HASH_OPERATIONS; op++)
+    {
+        filling = ! ((op / HASH_PHASE) & 1);
+        roll = randomIndex(&seed, 100);
+        key = randomIndex(&seed, HASH_KEYS);
+
+        // Only the addresses of the values are compared
+        if (roll < (filling ? 60 : 5))
+        {
+            value = values + randomIndex(&seed, HASH_KEYS);
+            table->insert(table, keys[key], value, false);
+            reference->insert(reference, keys[key], value, false);
+        }
+        else if (roll < (filling ? 80 : 85))
+        {
+            table->delete(table, keys[key]);
+            reference->delete(reference, keys[key]);
+        }
+
+        mismatches += table->search(table, keys[key]) !=
+                      reference->search(reference, keys[key]) ||
+                      table->count != reference->count;
+        checks++;
+
+        if ((op + 1) % HASH_PHASE)
+            continue;
+
+        // Once the table has grown or shrunk, every key is where it can be
+        // found and the shifts back have left nothing behind
+        found = 0;
+        HASHTABLE_FOR_EACH(table, iter)
+            found++;
+
+        mismatches += found != table->count;
+        checks++;
+
+        for (int i = 0; i < HASH_KEYS; i++)
+            mismatches += table->search(table, keys[i]) !=
+                          reference->search(reference, keys[i]);
+        checks += HASH_KEYS;
+    }
+
+    if (mismatches)
+        fprintf(stderr, ERR_HASH_MISMATCH, mismatches, checks);
+
+    if (! checkLongKey(table, values))
+        mismatches++;
+
+    table->deleteHashTableShallow(&table);
+    reference->deleteRefTable(&reference);
+    SAFE_FREE(keys);
+
+    return mismatches ? CASE_FAIL : CASE_PASS;
+}
+
+
+// Lookups of keys that are all present, through both tables
+static CaseResult compareLookups(void)
+{
+    unsigned int seed = 1;
+    int values[HASH_KEYS];
+    int found = 0;
+    int refFound = 0;
+    double start;
+    double tableTime;
+    double refTime;
+
+    char (*keys)[HASHTABLE_KEY_SIZE];
+    HashTable* table = NULL;
+    RefTable* reference = NULL;
+
+    if (! (keys = makeKeys()) || ! (table = newHashTable()) ||
+        ! (reference = newRefTable()))
+    {
+        fprintf(stderr, ERR_HASH_MALLOC);
+        if (table)
+            table->deleteHashTableShallow(&table);
+        SAFE_FREE(keys);
+        return CASE_FAIL;
+    }
+
+    for (int i = 0; i < HASH_KEYS; i++)
+    {
+        table->insert(table, keys[i], values + i, false);
+        reference->insert(reference, keys[i], values + i, false);
+    }
+
+    start = harnessTime();
+    for (int i = 0; i < HASH_LOOKUPS; i++)
+        found += table->search(table, keys[randomIndex(&seed, HASH_KEYS)]) !=
+                 NULL;
+    tableTime = (harnessTime() - start) * 1.0e9 / HASH_LOOKUPS;
+
+    seed = 1;
+    start = harnessTime();
+    for (int i = 0; i < HASH_LOOKUPS; i++)
+        refFound += reference->search(reference,
+                                      keys[randomIndex(&seed, HASH_KEYS)]) !=
+                    NULL;
+    refTime = (harnessTime() - start) * 1.0e9 / HASH_LOOKUPS;
+
+    printf("Hash tables: %d keys, %.2f ns per lookup, %.2f ns through the "
+           "old table\n", table->count, tableTime, refTime);
+
+    if (found != HASH_LOOKUPS || refFound != HASH_LOOKUPS)
+        fprintf(stderr, ERR_HASH_LOOKUPS, found, refFound, HASH_LOOKUPS);
+
+    table->deleteHashTableShallow(&table);
+    reference->deleteRefTable(&reference);
+    SAFE_FREE(keys);
+
+    return found == HASH_LOOKUPS && refFound == HASH_LOOKUPS ? CASE_PASS
+                                                             : CASE_FAIL;
+}
+
+
+// A key one past the inline limit must be turned away with an error rather
+// than cut short onto the key it starts with. The old table took any length,
+// so this is checked against the new table alone
+static bool checkLongKey(HashTable* table, int* values)
+{
+    char shortKey[HASHTABLE_KEY_SIZE];
+    char longKey[HASHTABLE_KEY_SIZE + 1];
+    char message[BUFSIZ];
+    char expected[BUFSIZ];
+    int count;
+    bool rejected;
+
+    memset(shortKey, '#', HASHTABLE_KEY_SIZE - 1);
+    shortKey[HASHTABLE_KEY_SIZE - 1] = '\0';
+    memset(longKey, '#', HASHTABLE_KEY_SIZE);
+    longKey[HASHTABLE_KEY_SIZE] = '\0';
+
+    table->insert(table, shortKey, values, false);
+    count = table->count;
+
+    // The rejection is expected, keep it out of the log but make sure it
+    // was reported
+    if (! captureStderr())
+        return false;
+
+    table->insert(table, longKey, values + 1, false);
+    releaseStderr(message, BUFSIZ);
+    snprintf(expected, BUFSIZ, ERR_HASHTABLE_KEY, longKey);
+
+    rejected = ! table->search(table, longKey) &&
+               table->search(table, shortKey) == values &&
+               table->count == count && ! strcmp(message, expected);
+
+    if (! rejected)
+        fprintf(stderr, ERR_HASH_LONG_KEY, HASHTABLE_KEY_SIZE);
+
+    table->deleteShallow(table, shortKey);
+
+    return rejected;
+}
+
+
+// Same keys every run, lowercase and of any length that fits inline
+static char (*makeKeys(void))[HASHTABLE_KEY_SIZE]
+{
+    unsigned int seed = 1;
+    int length;
+
+    char (*keys)[HASHTABLE_KEY_SIZE];
+
+    if (! (keys = (char (*)[HASHTABLE_KEY_SIZE])malloc(HASH_KEYS *
+                                                       HASHTABLE_KEY_SIZE)))
+        return NULL;
+
+    for (int i = 0; i < HASH_KEYS; i++)
+    {
+        length = 1 + randomIndex(&seed, HASHTABLE_KEY_SIZE - 1);
+
+        for (int j = 0; j < length; j++)
+            keys[i][j] = 'a' + randomIndex(&seed, 26);
+
+        keys[i][length] = '\0';
+    }
+
+    return keys;
+}
@@ -0,0 +1,315 @@
+// The original Hash Table with two fixes noted in reftable.h, adapted from:
+// https://github.com/jamesroutley/write-a-hash-table
+// Accessed 12/10/19
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+
+#include "reftable.h"
+
+static RefEntry DELETED = {NULL, NULL, false};
+
+static RefEntry* newRefEntry(const char*, void*, bool);
+static RefTable* newRefTableSized(const int);
+static void linkMethods(RefTable*);
+
+static void insert(RefTable*, const char*, void*, bool);
+static void* search(RefTable*, const char*);
+static void delete(RefTable*, const char*);
+
+static int hash(const char*, const int, const int);
+static void deleteRefEntry(RefEntry**);
+static void deleteRefEntryShallow(RefEntry**);
+static void deleteRefTable(RefTable**);
+static void deleteRefTableShallow(RefTable**);
+
+static void resize(RefTable*, const int);
+static int _hash(const char*, const int, const int);
+static int isPrime(const int);
+static int nextPrime(int);
+
+
+static RefEntry* newRefEntry(const char* key, void* value, bool isMalloc)
+{
+    RefEntry* entry;
+
+    if (! (entry = (RefEntry*)malloc(sizeof(RefEntry))))
+    {
+        fprintf(stderr, ERR_REFENTRY_MALLOC);
+        return NULL;
+    }
+
+    memset(entry, 0, sizeof(RefEntry));
+
+    if (! (entry->key = (char*)malloc(BUFSIZ * sizeof(char))))
+    {
+        fprintf(stderr, ERR_REFENTRY_MALLOC);
+        SAFE_FREE(entry);
+        return NULL;
+    }
+
+    strncpy(entry->key, key, BUFSIZ - 1);
+    entry->key[BUFSIZ - 1] = '\0';
+    entry->value = value;
+    entry->isMalloc = isMalloc;
+
+    return entry;
+}
+
+
+RefTable* newRefTable()
+{
+    return newRefTableSized(REFTABLE_BASE_SIZE);
+}
+
+
+static RefTable* newRefTableSized(const int baseSize)
+{
+    RefTable* table;
+
+    if (! (table = (RefTable*)malloc(sizeof(RefTable))))
+    {
+        fprintf(stderr, ERR_REFTABLE_MALLOC);
+        return NULL;
+    }
+
+    memset(table, 0, sizeof(RefTable));
+    table->baseSize = baseSize;
+    table->size = nextPrime(table->baseSize);
+
+    if (! (table->items = (RefEntry**)calloc(table->size, sizeof(RefEntry*))))
+    {
+        fprintf(stderr, ERR_REFTABLE_MALLOC);
+        SAFE_FREE(table);
+        return NULL;
+    }
+
+    linkMethods(table);
+
+    return table;
+}
+
+
+static void linkMethods(RefTable* this)
+{
+    this->insert = insert;
+    this->search = search;
+    this->delete = delete;
+
+    this->deleteRefTable = deleteRefTable;
+}
+
+
+static void insert(RefTable* this, const char* key, void* value, bool isMalloc)
+{
+    RefEntry* item;
+    RefEntry* current;
+    int index;
+    int i;
+
+    // The original only counted live entries, so enough churn filled every
+    // empty slot with tombstones and the probe below never ended. Rebuilding
+    // at the same size clears them
+    if (((this->count * 100) / this->size) > 70)
+        resize(this, this->baseSize << 1);
+    else if ((((this->count + this->deleted) * 100) / this->size) > 70)
+        resize(this, this->baseSize);
+
+    if (! (item = newRefEntry(key, value, isMalloc)))
+        return;
+
+    index = hash(item->key, this->size, 0);
+    current = this->items[index];
+    i = 0;
+
+    while (current != NULL)
+    {
+        if (current != &DELETED)
+        {
+            if (! strncmp(current->key, key, BUFSIZ))
+            {
+                deleteRefEntry(&current);
+                this->items[index] = item;
+                return;
+            }
+        }
+
+        index = hash(item->key, this->size, i++);
+        current = this->items[index];
+    }
+
+    this->items[index] = item;
+    this->count++;
+}
+
+
+static void* search(RefTable* this, const char* key)
+{
+    int index = hash(key, this->size, 0);
+    RefEntry* item = this->items[index];
+    int i = 1;
+
+    while (item != NULL)
+    {
+        if (item != &DELETED)
+            if (! strncmp(item->key, key, BUFSIZ))
+                return item->value;
+
+        index = hash(key, this->size, i++);
+        item = this->items[index];
+    }
+
+    return NULL;
+}
+
+
+static void delete(RefTable* this, const char* key)
+{
+    int index = hash(key, this->size, 0);
+    RefEntry* item = this->items[index];
+    int i = 1;
+
+    while (item != NULL)
+    {
+        if (item != &DELETED && ! strncmp(item->key, key, BUFSIZ))
+        {
+            deleteRefEntry(&item);
+            this->items[index] = &DELETED;
+            this->count--;
+            this->deleted++;
+            return;
+        }
+
+        index = hash(key, this->size, i++);
+        item = this->items[index];
+    }
+}
+
+
+static int hash(const char* string, const int bucket, const int attempt)
+{
+    const int a = _hash(string, REFTABLE_PRIME_1, bucket);
+    const int b = _hash(string, REFTABLE_PRIME_2, bucket);
+    return (a + attempt * (! b ? 1 : b)) % bucket;
+}
+
+
+static void deleteRefEntry(RefEntry** entry)
+{
+    if (*entry && *entry != &DELETED)
+    {
+        if ((*entry)->isMalloc)
+            SAFE_FREE((*entry)->value);
+
+        deleteRefEntryShallow(entry);
+    }
+}
+
+
+static void deleteRefEntryShallow(RefEntry** entry)
+{
+    if (*entry && *entry != &DELETED)
+    {
+        free((*entry)->key);
+        (*entry)->key = NULL;
+
+        free(*entry);
+        *entry = NULL;
+    }
+}
+
+
+static void deleteRefTable(RefTable** table)
+{
+    for (int i = 0; i < (*table)->size; i++)
+        deleteRefEntry((*table)->items + i);
+
+    SAFE_FREE((*table)->items);
+    SAFE_FREE(*table);
+}
+
+
+static void deleteRefTableShallow(RefTable** table)
+{
+    for (int i = 0; i < (*table)->size; i++)
+        deleteRefEntryShallow((*table)->items + i);
+
+    SAFE_FREE((*table)->items);
+    SAFE_FREE(*table);
+}
+
+
+static void resize(RefTable* table, const int baseSize)
+{
+    RefTable* newTable;
+    RefEntry* item;
+
+    RefEntry** tempItems;
+    int temp;
+
+    if (baseSize < REFTABLE_BASE_SIZE ||
+        ! (newTable = newRefTableSized(baseSize)))
+        return;
+
+    for (int i = 0; i < table->size; i++)
+        if ((item = table->items[i]) && item != &DELETED)
+            newTable->insert(newTable, item->key, item->value, item->isMalloc);
+
+    table->baseSize = newTable->baseSize;
+    table->count = newTable->count;
+    table->deleted = 0;
+
+    temp = table->size;
+    table->size = newTable->size;
+    newTable->size = temp;
+
+    tempItems = table->items;
+    table->items = newTable->items;
+    newTable->items = tempItems;
+
+    deleteRefTableShallow(&newTable);
+}
+
+
+// Powers are taken modulo the bucket as the sum goes, the original raised the
+// prime to the full power and overflowed on keys longer than seven characters
+static int _hash(const char* string, const int prime, const int bucket)
+{
+    long hash = 0;
+    const int length = strlen(string);
+    for (int i = 0; i < length; i++)
+    {
+        hash = (hash * prime + (unsigned char)string[i]) % bucket;
+    }
+
+    return (int)hash;
+}
+
+
+static int isPrime(const int x)
+{
+    if (x < 2)
+        return -1;
+    else if (x < 4)
+        return 1;
+    else if (! (x & 1))
+        return 0;
+
+    for (int i = 3; i <= floor(sqrt((double)x)); i += 2)
+        if (! (x % i))
+            return 0;
+
+    return 1;
+}
+
+
+static int nextPrime(int x)
+{
+    while (! isPrime(x++));
+    return x - 1;
+}
@@ -0,0 +1,190 @@
+#include <cglm/affine.h>
+#include <cglm/util.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "macros.h"
+#include "transform.h"
+
+#include "harness.h"
+
+// Box counts compared, each repeated until about TRANSFORM_TOTAL boxes are
+// timed. Elements may differ from glm by this much, relative to the element
+// where it is above 1 so large translations are judged fairly
+#define TRANSFORM_SIZES {1000, 10000, 100000}
+#define TRANSFORM_COUNTS 3
+#define TRANSFORM_TOTAL 1000000
+#define TRANSFORM_TOLERANCE 1.0e-5f
+
+#define ERR_TRANSFORM_MALLOC "Error: unable to allocate memory for transforms\n"
+#define ERR_TRANSFORM_MISMATCH "Error: %s transforms differ from glm on %d of %d matrices\n"
+
+
+static CaseResult compareTransforms(void);
+static void transformGlm(vec3*, vec3*, vec3*, vec3*, mat4*, int);
+static int countMismatches(mat4*, mat4*, int);
+
+
+static const HarnessCase cases[] = {
+    {"transforms", compareTransforms}
+};
+
+
+int main(int argc, char** argv)
+{
+    return runCases(cases, sizeof(cases) / sizeof(cases[0]), argc, argv);
+}
+
+
+// The batched kernel and one box at a time against the glm calls boxes used
+// to make
+static CaseResult compareTransforms(void)
+{
+    int sizes[] = TRANSFORM_SIZES;
+    int most = 0;
+    int count;
+    int repeats;
+    int batchMismatches = 0;
+    int singleMismatches = 0;
+    int total = 0;
+    unsigned int seed = 1;
+    double start;
+    double glmTime;
+    double singleTime;
+    double batchTime;
+
+    vec3* position;
+    vec3* rotation;
+    vec3* modelPosition;
+    vec3* scale;
+    mat4* expected;
+    mat4* batched;
+    mat4* single;
+
+    for (int i = 0; i < TRANSFORM_COUNTS; i++)
+        most = MAX(most, sizes[i]);
+
+    position = (vec3*)malloc(most * sizeof(vec3));
+    rotation = (vec3*)malloc(most * sizeof(vec3));
+    modelPosition = (vec3*)malloc(most * sizeof(vec3));
+    scale = (vec3*)malloc(most * sizeof(vec3));
+    expected = (mat4*)malloc(most * sizeof(mat4));
+    batched = (mat4*)malloc(most * sizeof(mat4));
+    single = (mat4*)malloc(most * sizeof(mat4));
+
+    if (! position || ! rotation || ! modelPosition || ! scale ||
+        ! expected || ! batched || ! single)
+    {
+        fprintf(stderr, ERR_TRANSFORM_MALLOC);
+        SAFE_FREE(position);
+        SAFE_FREE(rotation);
+        SAFE_FREE(modelPosition);
+        SAFE_FREE(scale);
+        SAFE_FREE(expected);
+        SAFE_FREE(batched);
+        SAFE_FREE(single);
+        return CASE_FAIL;
+    }
+
+    // Spread about as far as the scene's boxes, with any rotation at all
+    for (int i = 0; i < most; i++)
+        for (int j = 0; j < 3; j++)
+        {
+            position[i][j] = randomUnit(&seed) * 50.0f;
+            rotation[i][j] = randomUnit(&seed) * 360.0f;
+            modelPosition[i][j] = randomUnit(&seed) * 2.0f;
+            scale[i][j] = 1.05f + randomUnit(&seed) * 0.95f;
+        }
+
+    for (int i = 0; i < TRANSFORM_COUNTS; i++)
+    {
+        count = sizes[i];
+        repeats = MAX(TRANSFORM_TOTAL / count, 1);
+
+        start = harnessTime();
+        for (int j = 0; j < repeats; j++)
+            transformGlm(position, rotation, modelPosition, scale, expected,
+                         count);
+        glmTime = (harnessTime() - start) * 1.0e9 / (repeats * count);
+
+        start = harnessTime();
+        for (int j = 0; j < repeats; j++)
+            for (int k = 0; k < count; k++)
+                transformSingle(position[k], rotation[k], modelPosition[k],
+                                scale[k], single[k]);
+        singleTime = (harnessTime() - start) * 1.0e9 / (repeats * count);
+
+        start = harnessTime();
+        for (int j = 0; j < repeats; j++)
+            transformBatch(position, rotation, modelPosition, scale, batched,
+                           count);
+        batchTime = (harnessTime() - start) * 1.0e9 / (repeats * count);
+
+        printf("Transforms: %d boxes, %.2f ns per box batched, %.2f ns one "
+               "at a time, %.2f ns through glm\n", count, batchTime,
+               singleTime, glmTime);
+
+        batchMismatches += countMismatches(batched, expected, count);
+        singleMismatches += countMismatches(single, expected, count);
+        total += count;
+    }
+
+    if (batchMismatches)
+        fprintf(stderr, ERR_TRANSFORM_MISMATCH, "batched", batchMismatches,
+                total);
+
+    if (singleMismatches)
+        fprintf(stderr, ERR_TRANSFORM_MISMATCH, "single", singleMismatches,
+                total);
+
+    SAFE_FREE(position);
+    SAFE_FREE(rotation);
+    SAFE_FREE(modelPosition);
+    SAFE_FREE(scale);
+    SAFE_FREE(expected);
+    SAFE_FREE(batched);
+    SAFE_FREE(single);
+
+    return batchMismatches || singleMismatches ? CASE_FAIL : CASE_PASS;
+}
+
+
+// World matrices the way boxes built them before transformBatch
+static void transformGlm(vec3* position, vec3* rotation, vec3* modelPosition,
+                         vec3* scale, mat4* dest, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        glm_translate_make(dest[i], position[i]);
+        glm_rotate_x(dest[i], glm_rad(rotation[i][X_COORD]), dest[i]);
+        glm_rotate_y(dest[i], glm_rad(rotation[i][Y_COORD]), dest[i]);
+        glm_rotate_z(dest[i], glm_rad(rotation[i][Z_COORD]), dest[i]);
+        glm_translate(dest[i], modelPosition[i]);
+        glm_scale(dest[i], scale[i]);
+    }
+}
+
+
+static int countMismatches(mat4* actual, mat4* expected, int count)
+{
+    int mismatches = 0;
+    bool differs;
+
+    for (int i = 0; i < count; i++)
+    {
+        differs = false;
+
+        for (int j = 0; j < 4 && ! differs; j++)
+            for (int k = 0; k < 4 && ! differs; k++)
+                differs = fabsf(actual[i][j][k] - expected[i][j][k]) >
+                          TRANSFORM_TOLERANCE *
+                          MAX(fabsf(expected[i][j][k]), 1.0f);
+
+        mismatches += differs;
+    }
+
+    return mismatches;
+}
@@ -0,0 +1,184 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cglm/mat4.h>
+#include <cglm/vec3.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+#include "shader.h"
+
+#include "harness.h"
+
+// A frame of this many draws, each setting every active uniform by name the
+// way the game sets them, timed over this many frames
+#define UNIFORM_DRAWS 500
+#define UNIFORM_FRAMES 100
+
+#define ERR_UNIFORM_CONTEXT "Error: unable to create a hidden window for a GL context\n"
+#define ERR_UNIFORM_SHADER "Error: unable to build the game shader\n"
+#define ERR_UNIFORM_LOCATIONS "Error: cached and driver uniform locations differ on %d of %d uniforms\n"
+
+
+static CaseResult compareLookups(void);
+static GLFWwindow* makeContext(void);
+
+
+static const HarnessCase cases[] = {
+    {"uniforms", compareLookups}
+};
+
+
+int main(int argc, char** argv)
+{
+    return runCases(cases, sizeof(cases) / sizeof(cases[0]), argc, argv);
+}
+
+
+// Locations through the shader's cache against asking the driver each time,
+// as every set did before the cache
+static CaseResult compareLookups(void)
+{
+    char pool[MAX_UNIFORMS * UNIFORM_NAME_SIZE];
+    char* names[MAX_UNIFORMS];
+    char* bracket;
+    int used = 0;
+    int linked = 0;
+    int active = 0;
+    int count = 0;
+    int mismatches = 0;
+    int length;
+    int size;
+    GLenum type;
+    double start;
+    double cached;
+    double driver;
+
+    Shader* shader;
+
+    if (! makeContext())
+        return CASE_SKIP;
+
+    if (! (shader = newShader(NULL, "shaders/shader.vs", "shaders/shader.fs",
+                              NULL, 0)) ||
+        ! shader->ID)
+    {
+        fprintf(stderr, ERR_UNIFORM_SHADER);
+        SAFE_FREE(shader);
+        glfwTerminate();
+        return CASE_FAIL;
+    }
+
+    // Programs finish linking on first use, a broken one would otherwise
+    // pass with nothing to compare
+    shader->use(shader);
+    glGetProgramiv(shader->ID, GL_LINK_STATUS, &linked);
+
+    if (! linked)
+    {
+        fprintf(stderr, ERR_UNIFORM_SHADER);
+        glDeleteProgram(shader->ID);
+        SAFE_FREE(shader);
+        glfwTerminate();
+        return CASE_FAIL;
+    }
+
+    // Names held here rather than in the shader and packed back to back, so
+    // each one is looked up through the same pointer every time and laid out
+    // like the string literals the game passes. Members of uniform blocks
+    // have no location and are never set by name, so they are left out
+    glGetProgramiv(shader->ID, GL_ACTIVE_UNIFORMS, &active);
+    active = MIN(active, MAX_UNIFORMS);
+
+    for (int i = 0; i < active; i++)
+    {
+        names[count] = pool + used;
+        glGetActiveUniform(shader->ID, i, UNIFORM_NAME_SIZE, &length, &size,
+                           &type, names[count]);
+
+        if ((bracket = strchr(names[count], '[')))
+            *bracket = '\0';
+
+        if (glGetUniformLocation(shader->ID, names[count]) == -1)
+            continue;
+
+        used += strlen(names[count]) + 1;
+        count++;
+    }
+
+    for (int i = 0; i < count; i++)
+        mismatches += UNIFORM_LOC(shader, names[i]) !=
+                      glGetUniformLocation(shader->ID, names[i]);
+
+    if (mismatches)
+        fprintf(stderr, ERR_UNIFORM_LOCATIONS, mismatches, count);
+
+    start = harnessTime();
+    for (int i = 0; i < UNIFORM_FRAMES * UNIFORM_DRAWS; i++)
+        for (int j = 0; j < count; j++)
+            UNIFORM_LOC(shader, names[j]);
+    cached = (harnessTime() - start) / UNIFORM_FRAMES;
+
+    start = harnessTime();
+    for (int i = 0; i < UNIFORM_FRAMES * UNIFORM_DRAWS; i++)
+        for (int j = 0; j < count; j++)
+            glGetUniformLocation(shader->ID, names[j]);
+    driver = (harnessTime() - start) / UNIFORM_FRAMES;
+
+    if (count)
+        printf("Uniforms: %d active, %.2f ns per lookup cached, %.2f ns "
+               "through the driver, %.1f against %.1f us a frame of %d "
+               "draws\n", count,
+               cached * 1.0e9 / (UNIFORM_DRAWS * count),
+               driver * 1.0e9 / (UNIFORM_DRAWS * count),
+               cached * 1.0e6, driver * 1.0e6, UNIFORM_DRAWS);
+
+    glDeleteProgram(shader->ID);
+    SAFE_FREE(shader);
+    glfwTerminate();
+
+    return mismatches ? CASE_FAIL : CASE_PASS;
+}
+
+
+// Same context the game asks for, in a window that is never shown
+static GLFWwindow* makeContext(void)
+{
+    GLFWwindow* window;
+
+    if (! glfwInit())
+    {
+        fprintf(stderr, ERR_UNIFORM_CONTEXT);
+        return NULL;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    if (! (window = glfwCreateWindow(64, 64, "uniforms", NULL, NULL)))
+    {
+        fprintf(stderr, ERR_UNIFORM_CONTEXT);
+        glfwTerminate();
+        return NULL;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (! gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        fprintf(stderr, ERR_UNIFORM_CONTEXT);
+        glfwTerminate();
+        return NULL;
+    }
+
+    return window;
+}
@@ -0,0 +1,294 @@
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <stb_image.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/macros.h"
+#include "../src/pack.h"
+
+#define USAGE "Usage: %s OUTPUT NAME=FILE...\n"
+#define ERR_PACKER_ARG "Error: expected NAME=FILE, got \"%s\"\n"
+#define ERR_PACKER_NAME "Error: name \"%s\" is too long or repeated\n"
+#define ERR_PACKER_READ "Error: unable to read \"%s\"\n"
+#define ERR_PACKER_WRITE "Error: unable to write \"%s\"\n"
+#define ERR_PACKER_MALLOC "Error: unable to allocate memory for \"%s\"\n"
+
+
+// Build time tool turning the loose resources and shaders into the pack the
+// game maps at startup, so it never decodes an image itself
+
+
+typedef struct Input
+{
+    PackEntry entry;
+    unsigned char* data;
+} Input;
+
+
+static bool readInput(Input*, char*);
+static unsigned char* readImage(PackEntry*, const char*);
+static unsigned char* readText(PackEntry*, const char*);
+static void downsample(unsigned char*, int, int, unsigned char*);
+static bool isImage(const char*);
+static bool writePack(const char*, Input*, int);
+static int compareInputs(const void*, const void*);
+
+
+int main(int argc, char** argv)
+{
+    Input* inputs;
+    int count = argc - 2;
+    bool ok = true;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+
+    if (! (inputs = (Input*)calloc(count, sizeof(Input))))
+    {
+        fprintf(stderr, ERR_PACKER_MALLOC, argv[1]);
+        return 1;
+    }
+
+    for (int i = 0; i < count && ok; i++)
+        ok = readInput(inputs + i, argv[i + 2]);
+
+    // Sorted so the game can binary search the table of contents
+    qsort(inputs, count, sizeof(Input), compareInputs);
+
+    for (int i = 1; i < count && ok; i++)
+    {
+        if (! strcmp(inputs[i - 1].entry.name, inputs[i].entry.name))
+        {
+            fprintf(stderr, ERR_PACKER_NAME, inputs[i].entry.name);
+            ok = false;
+        }
+    }
+
+    ok = ok && writePack(argv[1], inputs, count);
+
+    for (int i = 0; i < count; i++)
+        SAFE_FREE(inputs[i].data);
+
+    SAFE_FREE(inputs);
+
+    return ok ? 0 : 1;
+}
+
+
+static bool readInput(Input* input, char* argument)
+{
+    char* separator = strchr(argument, '=');
+    char* filename;
+
+    if (! separator)
+    {
+        fprintf(stderr, ERR_PACKER_ARG, argument);
+        return false;
+    }
+
+    if (separator - argument >= PACK_NAME_SIZE)
+    {
+        fprintf(stderr, ERR_PACKER_NAME, argument);
+        return false;
+    }
+
+    filename = separator + 1;
+    memcpy(input->entry.name, argument, separator - argument);
+
+    if (isImage(filename))
+        input->data = readImage(&(input->entry), filename);
+    else
+        input->data = readText(&(input->entry), filename);
+
+    if (! input->data)
+        fprintf(stderr, ERR_PACKER_READ, filename);
+
+    return input->data != NULL;
+}
+
+
+static unsigned char* readImage(PackEntry* entry, const char* filename)
+{
+    unsigned char* image;
+    unsigned char* data;
+    unsigned char* level;
+    int width;
+    int height;
+    int channels;
+
+    // Same orientation and channel count the game's own loader produces
+    stbi_set_flip_vertically_on_load(true);
+
+    if (! (image = stbi_load(filename, &width, &height, &channels, 4)))
+        return NULL;
+
+    entry->type = PACK_IMAGE;
+    entry->width = width;
+    entry->height = height;
+    entry->levels = 1;
+
+    // Down to 1x1, matching what glGenerateMipmap would have made
+    while ((width >> entry->levels) || (height >> entry->levels))
+        entry->levels++;
+
+    for (unsigned int i = 0; i < entry->levels; i++)
+        entry->size += packLevelSize(entry, i);
+
+    if ((data = (unsigned char*)malloc(entry->size)))
+    {
+        memcpy(data, image, packLevelSize(entry, 0));
+
+        // Each level is filtered from the one before it
+        level = data;
+
+        for (unsigned int i = 1; i < entry->levels; i++)
+        {
+            downsample(level, MAX(width >> (i - 1), 1),
+                       MAX(height >> (i - 1), 1),
+                       level + packLevelSize(entry, i - 1));
+            level += packLevelSize(entry, i - 1);
+        }
+    }
+
+    stbi_image_free(image);
+
+    return data;
+}
+
+
+static unsigned char* readText(PackEntry* entry, const char* filename)
+{
+    unsigned char* data = NULL;
+    long size;
+    FILE* fp;
+
+    if (! (fp = fopen(filename, "rb")))
+        return NULL;
+
+    if (! fseek(fp, 0, SEEK_END) && (size = ftell(fp)) >= 0 &&
+        ! fseek(fp, 0, SEEK_SET) &&
+        (data = (unsigned char*)malloc(MAX(size, 1))))
+    {
+        entry->type = PACK_TEXT;
+        entry->size = size;
+
+        if (fread(data, 1, size, fp) != (size_t)size)
+            SAFE_FREE(data);
+    }
+
+    fclose(fp);
+
+    return data;
+}
+
+
+// Box filter halving each side, an odd last row or column is folded into its
+// neighbour by clamping
+static void downsample(unsigned char* src, int width, int height,
+                       unsigned char* dst)
+{
+    int dstWidth = MAX(width >> 1, 1);
+    int dstHeight = MAX(height >> 1, 1);
+    int x[2];
+    int y[2];
+    int sum;
+
+    for (int row = 0; row < dstHeight; row++)
+    {
+        y[0] = MIN(row * 2, height - 1);
+        y[1] = MIN(row * 2 + 1, height - 1);
+
+        for (int column = 0; column < dstWidth; column++)
+        {
+            x[0] = MIN(column * 2, width - 1);
+            x[1] = MIN(column * 2 + 1, width - 1);
+
+            for (int c = 0; c < 4; c++)
+            {
+                sum = src[(y[0] * width + x[0]) * 4 + c] +
+                      src[(y[0] * width + x[1]) * 4 + c] +
+                      src[(y[1] * width + x[0]) * 4 + c] +
+                      src[(y[1] * width + x[1]) * 4 + c];
+
+                dst[(row * dstWidth + column) * 4 + c] = (sum + 2) / 4;
+            }
+        }
+    }
+}
+
+
+static bool isImage(const char* filename)
+{
+    const char* extension = strrchr(filename, '.');
+
+    return extension && (! strcmp(extension, ".png") ||
+                         ! strcmp(extension, ".jpg"));
+}
+
+
+static bool writePack(const char* filename, Input* inputs, int count)
+{
+    static const unsigned char padding[PACK_ALIGN];
+    PackHeader header;
+    uint64_t offset;
+    bool ok = true;
+    FILE* fp;
+
+    memset(&header, 0, sizeof(PackHeader));
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.entryCount = count;
+
+    offset = sizeof(PackHeader) + count * sizeof(PackEntry);
+
+    for (int i = 0; i < count; i++)
+    {
+        offset = (offset + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN;
+        inputs[i].entry.offset = offset;
+        offset += inputs[i].entry.size;
+    }
+
+    if (! (fp = fopen(filename, "wb")))
+    {
+        fprintf(stderr, ERR_PACKER_WRITE, filename);
+        return false;
+    }
+
+    ok = fwrite(&header, sizeof(PackHeader), 1, fp) == 1;
+
+    for (int i = 0; i < count && ok; i++)
+        ok = fwrite(&(inputs[i].entry), sizeof(PackEntry), 1, fp) == 1;
+
+    for (int i = 0; i < count && ok; i++)
+    {
+        offset = inputs[i].entry.offset - ftell(fp);
+
+        ok = fwrite(padding, 1, offset, fp) == offset &&
+             fwrite(inputs[i].data, 1, inputs[i].entry.size, fp) ==
+                inputs[i].entry.size;
+    }
+
+    ok = ! fclose(fp) && ok;
+
+    if (! ok)
+    {
+        fprintf(stderr, ERR_PACKER_WRITE, filename);
+        remove(filename);
+    }
+
+    return ok;
+}
+
+
+static int compareInputs(const void* a, const void* b)
+{
+    return strncmp(((Input*)a)->entry.name, ((Input*)b)->entry.name,
+                   PACK_NAME_SIZE);
+}